@@ -5,6 +5,7 @@ varying vec2 sf_texCoord;
 uniform sampler2D sf_sampler;
 uniform mat4 sf_texture;
 #endif
+uniform sampler2D palette;
 uniform float time;
 uniform vec4 goldColor;
 uniform vec4 whiteColor;
@@ -13,12 +14,14 @@ uniform vec4 redColor;
 void main()
 {
 #ifdef GL_ES
-    vec4 color = sf_color;
+    vec4 owner = sf_color;
     vec2 texCoord = sf_texCoord;
 #else
-    vec4 color = gl_Color;
+    vec4 owner = gl_Color;
     vec2 texCoord = gl_TexCoord[0].xy;
 #endif
+    //the red channel holds the owner of the tile, the color comes from the palette
+    vec4 color = texture2D(palette, vec2((floor(owner.r * 255.0 + 0.5) + 0.5) / 256.0, 0.5));
     if (color == redColor)
     {
         gl_FragColor = color;
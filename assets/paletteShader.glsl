@@ -0,0 +1,18 @@
+#ifdef GL_ES
+precision mediump float;
+varying vec4 sf_color;
+varying vec2 sf_texCoord;
+uniform sampler2D sf_sampler;
+uniform mat4 sf_texture;
+#endif
+uniform sampler2D palette;
+void main()
+{
+#ifdef GL_ES
+    vec4 owner = sf_color;
+#else
+    vec4 owner = gl_Color;
+#endif
+    //the red channel holds the owner of the tile, the color comes from the palette
+    gl_FragColor = texture2D(palette, vec2((floor(owner.r * 255.0 + 0.5) + 0.5) / 256.0, 0.5));
+}
@@ -0,0 +1,136 @@
+// Ball against ball contacts. Every tick the balls are counting-sorted into
+// a spatial hash keyed on the tile they are in, so a ball is only tested
+// against the balls of the tiles around it and the cost grows with the
+// number of balls instead of with the number of pairs.
+
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "BallKernel.h"
+
+class BallContacts
+{
+public:
+	/// <summary>
+	/// Separates every pair of touching balls and, when they are closing in,
+	/// swaps the parts of their directions along the line between them, the
+	/// elastic collision of two equal masses. Pairs are resolved in ball
+	/// order, so the outcome only depends on the state of the balls.
+	/// touched(ball) is called for both balls of every contact.
+	/// Returns the number of contacts.
+	/// </summary>
+	template<typename F>
+	int resolve(BallArrays& balls, float radius, const sf::Vector2f& tileSize, const sf::Vector2u& mapSize, F&& touched)
+	{
+		Build(balls, tileSize, mapSize);
+		//tiles smaller than a ball need a wider neighbourhood to see every contact
+		const int reach = std::max(1, static_cast<int>(std::ceil(2 * radius / std::min(tileSize.x, tileSize.y))));
+		const float contact = 2 * radius;
+		const sf::Vector2f canvasSize = sf::Vector2f(mapSize.x * tileSize.x, mapSize.y * tileSize.y);
+		int contacts = 0;
+		const int count = static_cast<int>(balls.size());
+		for (int i = 0; i < count; i++)
+		{
+			if (!balls.alive[i])
+				continue;
+			//the tile the ball was hashed in, pushes by earlier pairs do not move it
+			const sf::Vector2i tile = sf::Vector2i(keys[i] % mapSize.x, keys[i] / mapSize.x);
+			for (int y = std::max(0, tile.y - reach); y <= std::min(static_cast<int>(mapSize.y) - 1, tile.y + reach); y++)
+				for (int x = std::max(0, tile.x - reach); x <= std::min(static_cast<int>(mapSize.x) - 1, tile.x + reach); x++)
+				{
+					const sf::Uint32 key = static_cast<sf::Uint32>(y) * mapSize.x + x;
+					const sf::Uint32 bucket = Bucket(key);
+					for (sf::Uint32 e = bucketStart[bucket]; e < bucketStart[bucket + 1]; e++)
+					{
+						//other tiles can share the bucket, each ball is only seen from its own tile
+						const int j = sorted[e];
+						if (j <= i || keys[j] != key)
+							continue;
+						if (Collide(balls, i, j, contact, radius, canvasSize))
+						{
+							contacts++;
+							touched(i);
+							touched(j);
+						}
+					}
+				}
+		}
+		return contacts;
+	}
+private:
+	/// <summary>
+	/// Counting sort of the living balls by bucket. Balls go in ball order,
+	/// so every bucket lists its balls in ascending order.
+	/// </summary>
+	void Build(const BallArrays& balls, const sf::Vector2f& tileSize, const sf::Vector2u& mapSize)
+	{
+		const size_t count = balls.size();
+		//about two buckets per ball keeps them short whatever the size of the map
+		bits = 1;
+		while ((size_t(1) << bits) < count * 2 && bits < 31)
+			bits++;
+		bucketStart.assign((size_t(1) << bits) + 1, 0);
+		keys.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			if (!balls.alive[i])
+				continue;
+			const sf::Vector2i tile = TileOf(balls.x[i], balls.y[i], tileSize, mapSize);
+			keys[i] = static_cast<sf::Uint32>(tile.y) * mapSize.x + tile.x;
+			bucketStart[Bucket(keys[i]) + 1]++;
+		}
+		for (size_t b = 1; b < bucketStart.size(); b++)
+			bucketStart[b] += bucketStart[b - 1];
+		sorted.resize(bucketStart.back());
+		fill.assign(bucketStart.begin(), bucketStart.end() - 1);
+		for (size_t i = 0; i < count; i++)
+			if (balls.alive[i])
+				sorted[fill[Bucket(keys[i])]++] = static_cast<int>(i);
+	}
+	sf::Uint32 Bucket(sf::Uint32 key) const
+	{
+		//Fibonacci hashing, neighbouring tiles land far apart
+		return (key * 2654435769u) >> (32 - bits);
+	}
+	static sf::Vector2i TileOf(float x, float y, const sf::Vector2f& tileSize, const sf::Vector2u& mapSize)
+	{
+		const int tileX = static_cast<int>(std::floor(x / tileSize.x));
+		const int tileY = static_cast<int>(std::floor(y / tileSize.y));
+		return sf::Vector2i(std::max(0, std::min(tileX, static_cast<int>(mapSize.x) - 1)), std::max(0, std::min(tileY, static_cast<int>(mapSize.y) - 1)));
+	}
+	static bool Collide(BallArrays& balls, int i, int j, float contact, float radius, const sf::Vector2f& canvasSize)
+	{
+		const float offsetX = balls.x[j] - balls.x[i];
+		const float offsetY = balls.y[j] - balls.y[i];
+		const float distanceSqr = offsetX * offsetX + offsetY * offsetY;
+		if (distanceSqr >= contact * contact)
+			return false;
+		const float distance = std::sqrt(distanceSqr);
+		//balls on the exact same spot are split along x
+		const float normalX = distance > 0 ? offsetX / distance : 1.f;
+		const float normalY = distance > 0 ? offsetY / distance : 0.f;
+		const float closing = (balls.dx[i] - balls.dx[j]) * normalX + (balls.dy[i] - balls.dy[j]) * normalY;
+		if (closing > 0)
+		{
+			balls.dx[i] -= closing * normalX;
+			balls.dy[i] -= closing * normalY;
+			balls.dx[j] += closing * normalX;
+			balls.dy[j] += closing * normalY;
+		}
+		//each ball moves half the overlap, never through a wall
+		const float push = (contact - distance) / 2;
+		balls.x[i] = std::max(radius, std::min(balls.x[i] - normalX * push, canvasSize.x - radius));
+		balls.y[i] = std::max(radius, std::min(balls.y[i] - normalY * push, canvasSize.y - radius));
+		balls.x[j] = std::max(radius, std::min(balls.x[j] + normalX * push, canvasSize.x - radius));
+		balls.y[j] = std::max(radius, std::min(balls.y[j] + normalY * push, canvasSize.y - radius));
+		return true;
+	}
+
+	int bits = 1;
+	std::vector<sf::Uint32> keys;
+	std::vector<sf::Uint32> bucketStart;
+	std::vector<sf::Uint32> fill;
+	std::vector<int> sorted;
+};
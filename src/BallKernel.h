@@ -0,0 +1,403 @@
+// Ball state stored as structure of arrays together with the movement
+// and ball-vs-tile kernel that advances it. The kernel is vectorized with
+// AVX2 or SSE2 when the compiler targets them and falls back to scalar code
+// everywhere else. Both paths produce bit-identical results as long as the
+// compiler does not contract the scalar math into FMA (-ffp-contract=off).
+
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <cmath>
+#include "OwnershipGrid.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BALLKERNEL_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BALLKERNEL_SSE2
+#endif
+
+inline bool Circle_Rectangle(const sf::Vector2f& pos1, const float radius1, const sf::FloatRect& rectangle)
+{
+	sf::Vector2f tests = pos1;
+	if (pos1.x < rectangle.left)
+		tests.x = rectangle.left;
+	else if (pos1.x > rectangle.left + rectangle.width)
+		tests.x = rectangle.left + rectangle.width;
+
+	if (pos1.y < rectangle.top)
+		tests.y = rectangle.top;
+	else if (pos1.y > rectangle.top + rectangle.height)
+		tests.y = rectangle.top + rectangle.height;
+
+	sf::Vector2f dist = sf::Vector2f(pos1.x - tests.x, pos1.y - tests.y);
+	float distanceSqr = (dist.x * dist.x) + (dist.y * dist.y);
+	if (distanceSqr <= radius1 * radius1)
+		return 1;
+	return 0;
+}
+
+struct BallArrays
+{
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> dx;
+	std::vector<float> dy;
+	std::vector<float> prevX;
+	std::vector<float> prevY;
+	std::vector<sf::Uint8> team;
+	std::vector<sf::Uint8> alive;
+
+	void resize(size_t count)
+	{
+		x.resize(count);
+		y.resize(count);
+		dx.resize(count);
+		dy.resize(count);
+		prevX.resize(count);
+		prevY.resize(count);
+		team.resize(count);
+		alive.resize(count);
+	}
+	size_t size() const
+	{
+		return x.size();
+	}
+	sf::Vector2f getPosition(size_t i) const
+	{
+		return sf::Vector2f(x[i], y[i]);
+	}
+	sf::Vector2f getPrevPosition(size_t i) const
+	{
+		return sf::Vector2f(prevX[i], prevY[i]);
+	}
+};
+
+/// <summary>
+/// A ball touched a tile that its team does not own.
+/// owner is the owner of the tile at the time of the contact.
+/// </summary>
+struct BallHit
+{
+	int ball;
+	int tileX;
+	int tileY;
+	sf::Uint8 owner;
+};
+
+struct SweepParams
+{
+	sf::Vector2f tileSize;
+	sf::Vector2f canvasSize;
+	float radius;
+	float delta;
+	float speed;
+	float steps;
+};
+
+/// <summary>
+/// Looks for the first enemy tile in the 3x3 neighbourhood of the
+/// position that the circle overlaps.
+/// </summary>
+inline bool FindTileHit(const sf::Vector2f& pos, sf::Uint8 team, const SweepParams& params, const OwnershipGrid& map, BallHit& hit)
+{
+	const int cellX = static_cast<int>(std::floor(pos.x / params.tileSize.x));
+	const int cellY = static_cast<int>(std::floor(pos.y / params.tileSize.y));
+	for (int j = -1; j <= 1; j++)
+		for (int k = -1; k <= 1; k++)
+		{
+			const int coordX = cellX + j;
+			const int coordY = cellY + k;
+			if (!map.contains(coordX, coordY) || map(coordX, coordY) == team + 1)
+				continue;
+			if (Circle_Rectangle(pos, params.radius, sf::FloatRect(params.tileSize.x * coordX, params.tileSize.y * coordY, params.tileSize.x, params.tileSize.y)))
+			{
+				hit.tileX = coordX;
+				hit.tileY = coordY;
+				hit.owner = map(coordX, coordY);
+				return true;
+			}
+		}
+	return false;
+}
+
+/// <summary>
+/// Number of whole ticks, at most maxTicks, that the ball can move on
+/// without touching an enemy tile or a wall. params.delta is a full tick.
+/// The path is taken as a straight line and every obstacle is grown by the
+/// radius plus one tick of movement, which covers the corner cut by the two
+/// axis sweeps of a tick. area receives the tiles the path can reach.
+/// </summary>
+inline int PredictContact(const BallArrays& balls, int i, const SweepParams& params, const OwnershipGrid& map, int maxTicks, sf::IntRect& area)
+{
+	const float px = balls.x[i];
+	const float py = balls.y[i];
+	const float vx = balls.dx[i] * params.delta * params.speed;
+	const float vy = balls.dy[i] * params.delta * params.speed;
+	//the small extra keeps the float drift of the moves from turning a graze into a miss
+	const float margin = params.radius + std::max(std::abs(vx), std::abs(vy)) + params.tileSize.x * 0.001f;
+	const float never = static_cast<float>(maxTicks) + 1;
+	auto wall = [&](float p, float v, float limit)
+	{
+		if (p - margin < 0 || p + margin >= limit)
+			return 0.f;
+		if (v > 0)
+			return (limit - margin - p) / v;
+		if (v < 0)
+			return (p - margin) / -v;
+		return never;
+	};
+	float contact = std::min(never, std::min(wall(px, vx, params.canvasSize.x), wall(py, vy, params.canvasSize.y)));
+	auto reach = [&](int ticks)
+	{
+		const float ex = px + vx * ticks;
+		const float ey = py + vy * ticks;
+		const int left = std::max(0, static_cast<int>(std::floor((std::min(px, ex) - margin) / params.tileSize.x)));
+		const int top = std::max(0, static_cast<int>(std::floor((std::min(py, ey) - margin) / params.tileSize.y)));
+		const int right = std::min(static_cast<int>(map.getSize().x), static_cast<int>(std::floor((std::max(px, ex) + margin) / params.tileSize.x)) + 1);
+		const int bottom = std::min(static_cast<int>(map.getSize().y), static_cast<int>(std::floor((std::max(py, ey) + margin) / params.tileSize.y)) + 1);
+		return sf::IntRect(left, top, std::max(0, right - left), std::max(0, bottom - top));
+	};
+	//slab test of the path against every enemy tile it can reach
+	auto slab = [&](float p, float v, float low, float high, float& enter, float& exit)
+	{
+		if (v == 0)
+		{
+			if (p < low || p > high)
+				enter = never;
+			return;
+		}
+		const float t1 = (low - p) / v;
+		const float t2 = (high - p) / v;
+		enter = std::max(enter, std::min(t1, t2));
+		exit = std::min(exit, std::max(t1, t2));
+	};
+	area = reach(maxTicks);
+	const sf::Uint8 own = balls.team[i] + 1;
+	for (int x = area.left; x < area.left + area.width; x++)
+		for (int y = area.top; y < area.top + area.height; y++)
+		{
+			if (map(x, y) == own)
+				continue;
+			float enter = 0;
+			float exit = never;
+			const float left = x * params.tileSize.x;
+			const float top = y * params.tileSize.y;
+			slab(px, vx, left - margin, left + params.tileSize.x + margin, enter, exit);
+			slab(py, vy, top - margin, top + params.tileSize.y + margin, enter, exit);
+			if (enter <= exit && exit >= 0)
+				contact = std::min(contact, std::max(enter, 0.f));
+		}
+	const int ticks = contact >= never ? maxTicks : std::max(0, std::min(maxTicks, static_cast<int>(std::ceil(contact)) - 1));
+	area = reach(ticks);
+	return ticks;
+}
+
+/// <summary>
+/// Moves a single ball by one sub-step along one axis, bouncing it off
+/// enemy tiles and walls. Tiles are not captured here, contacts are
+/// appended to hits instead.
+/// </summary>
+inline void SweepBall(BallArrays& balls, int i, bool horizontal, const SweepParams& params, const OwnershipGrid& map, std::vector<BallHit>& hits)
+{
+	float& pos = horizontal ? balls.x[i] : balls.y[i];
+	float& dir = horizontal ? balls.dx[i] : balls.dy[i];
+	const float limit = horizontal ? params.canvasSize.x : params.canvasSize.y;
+	bool changed = false;
+	pos += dir * params.delta * params.speed / params.steps;
+	BallHit hit;
+	if (FindTileHit(balls.getPosition(i), balls.team[i], params, map, hit))
+	{
+		hit.ball = i;
+		hits.push_back(hit);
+		changed = true;
+		dir = -dir;
+	}
+	//walls only turn the component around, a ball that is not on a diagonal keeps its speed
+	if (pos - params.radius < 0)
+	{
+		changed = true;
+		dir = std::abs(dir);
+	}
+	if (pos + params.radius >= limit)
+	{
+		changed = true;
+		dir = -std::abs(dir);
+	}
+	if (changed)
+		pos += dir * params.delta * params.speed / params.steps;
+}
+
+#if defined(BALLKERNEL_AVX2) || defined(BALLKERNEL_SSE2)
+namespace simd
+{
+#if defined(BALLKERNEL_AVX2)
+	struct Lanes
+	{
+		typedef __m256 Type;
+		static constexpr int Width = 8;
+		static Type Load(const float* p) { return _mm256_loadu_ps(p); }
+		static void Store(float* p, Type a) { _mm256_storeu_ps(p, a); }
+		static Type Set(float a) { return _mm256_set1_ps(a); }
+		static Type Add(Type a, Type b) { return _mm256_add_ps(a, b); }
+		static Type Sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+		static Type Mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+		static Type Div(Type a, Type b) { return _mm256_div_ps(a, b); }
+		static Type Min(Type a, Type b) { return _mm256_min_ps(a, b); }
+		static Type Max(Type a, Type b) { return _mm256_max_ps(a, b); }
+		static Type Xor(Type a, Type b) { return _mm256_xor_ps(a, b); }
+		static Type AndNot(Type a, Type b) { return _mm256_andnot_ps(a, b); }
+		static Type Or(Type a, Type b) { return _mm256_or_ps(a, b); }
+		static Type CmpLt(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		static Type CmpLe(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+		static Type CmpGe(Type a, Type b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+		static Type Select(Type mask, Type a, Type b) { return _mm256_blendv_ps(b, a, mask); }
+		static Type Floor(Type a) { return _mm256_floor_ps(a); }
+		static int MoveMask(Type a) { return _mm256_movemask_ps(a); }
+	};
+#else
+	struct Lanes
+	{
+		typedef __m128 Type;
+		static constexpr int Width = 4;
+		static Type Load(const float* p) { return _mm_loadu_ps(p); }
+		static void Store(float* p, Type a) { _mm_storeu_ps(p, a); }
+		static Type Set(float a) { return _mm_set1_ps(a); }
+		static Type Add(Type a, Type b) { return _mm_add_ps(a, b); }
+		static Type Sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+		static Type Mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+		static Type Div(Type a, Type b) { return _mm_div_ps(a, b); }
+		static Type Min(Type a, Type b) { return _mm_min_ps(a, b); }
+		static Type Max(Type a, Type b) { return _mm_max_ps(a, b); }
+		static Type Xor(Type a, Type b) { return _mm_xor_ps(a, b); }
+		static Type AndNot(Type a, Type b) { return _mm_andnot_ps(a, b); }
+		static Type Or(Type a, Type b) { return _mm_or_ps(a, b); }
+		static Type CmpLt(Type a, Type b) { return _mm_cmplt_ps(a, b); }
+		static Type CmpLe(Type a, Type b) { return _mm_cmple_ps(a, b); }
+		static Type CmpGe(Type a, Type b) { return _mm_cmpge_ps(a, b); }
+		static Type Select(Type mask, Type a, Type b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+		static Type Floor(Type a)
+		{
+			const Type truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+			return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, a), _mm_set1_ps(1.f)));
+		}
+		static int MoveMask(Type a) { return _mm_movemask_ps(a); }
+	};
+#endif
+	inline Lanes::Type MaskFromBits(int bits)
+	{
+		alignas(32) sf::Int32 mask[Lanes::Width];
+		for (int l = 0; l < Lanes::Width; l++)
+			mask[l] = (bits >> l) & 1 ? -1 : 0;
+		return Lanes::Load(reinterpret_cast<const float*>(mask));
+	}
+}
+#endif
+
+/// <summary>
+/// Advances the balls in [begin, end) by one sub-step along one axis.
+/// Every ball reads the same map, so ranges can be processed in any order
+/// and the hits come out sorted by ball index.
+/// </summary>
+inline void SweepBalls(BallArrays& balls, int begin, int end, bool horizontal, const SweepParams& params, const OwnershipGrid& map, std::vector<BallHit>& hits)
+{
+	int i = begin;
+#if defined(BALLKERNEL_AVX2) || defined(BALLKERNEL_SSE2)
+	using L = simd::Lanes;
+	constexpr int W = L::Width;
+	float* pos = horizontal ? balls.x.data() : balls.y.data();
+	const float* other = horizontal ? balls.y.data() : balls.x.data();
+	float* dir = horizontal ? balls.dx.data() : balls.dy.data();
+	const L::Type delta = L::Set(params.delta);
+	const L::Type speed = L::Set(params.speed);
+	const L::Type steps = L::Set(params.steps);
+	const L::Type radius = L::Set(params.radius);
+	const L::Type radiusSqr = L::Set(params.radius * params.radius);
+	const L::Type limit = L::Set(horizontal ? params.canvasSize.x : params.canvasSize.y);
+	const L::Type tileW = L::Set(params.tileSize.x);
+	const L::Type tileH = L::Set(params.tileSize.y);
+	const L::Type zero = L::Set(0.f);
+	const L::Type signBit = L::Set(-0.f);
+	alignas(32) float cellX[W];
+	alignas(32) float cellY[W];
+	for (; i + W <= end; i += W)
+	{
+		int aliveBits = 0;
+		for (int l = 0; l < W; l++)
+			aliveBits |= (balls.alive[i + l] ? 1 : 0) << l;
+		if (aliveBits == 0)
+			continue;
+
+		const L::Type p0 = L::Load(pos + i);
+		const L::Type d0 = L::Load(dir + i);
+		const L::Type p1 = L::Add(p0, L::Div(L::Mul(L::Mul(d0, delta), speed), steps));
+		const L::Type q = L::Load(other + i);
+		const L::Type bx = horizontal ? p1 : q;
+		const L::Type by = horizontal ? q : p1;
+		const L::Type fx = L::Floor(L::Div(bx, tileW));
+		const L::Type fy = L::Floor(L::Div(by, tileH));
+		L::Store(cellX, fx);
+		L::Store(cellY, fy);
+
+		//narrow phase against the 3x3 neighbourhood, the first hit in scan order wins
+		int found = 0;
+		int hitTile[W];
+		for (int j = -1; j <= 1; j++)
+		{
+			const L::Type left = L::Mul(L::Add(fx, L::Set(static_cast<float>(j))), tileW);
+			const L::Type right = L::Add(left, tileW);
+			const L::Type clampedX = L::Min(L::Max(bx, left), right);
+			const L::Type distX = L::Sub(bx, clampedX);
+			for (int k = -1; k <= 1; k++)
+			{
+				int enemyBits = 0;
+				for (int l = 0; l < W; l++)
+				{
+					const int coordX = static_cast<int>(cellX[l]) + j;
+					const int coordY = static_cast<int>(cellY[l]) + k;
+					if (map.contains(coordX, coordY) && map(coordX, coordY) != balls.team[i + l] + 1)
+						enemyBits |= 1 << l;
+				}
+				enemyBits &= aliveBits & ~found;
+				if (enemyBits == 0)
+					continue;
+				const L::Type top = L::Mul(L::Add(fy, L::Set(static_cast<float>(k))), tileH);
+				const L::Type bottom = L::Add(top, tileH);
+				const L::Type distY = L::Sub(by, L::Min(L::Max(by, top), bottom));
+				const L::Type distanceSqr = L::Add(L::Mul(distX, distX), L::Mul(distY, distY));
+				const int hitBits = L::MoveMask(L::CmpLe(distanceSqr, radiusSqr)) & enemyBits;
+				for (int l = 0; l < W; l++)
+					if (hitBits & (1 << l))
+						hitTile[l] = (j + 1) * 3 + k + 1;
+				found |= hitBits;
+			}
+		}
+
+		const L::Type hitMask = simd::MaskFromBits(found);
+		L::Type d1 = L::Select(hitMask, L::Xor(d0, signBit), d0);
+		const L::Type leftWall = L::CmpLt(L::Sub(p1, radius), zero);
+		d1 = L::Select(leftWall, L::AndNot(signBit, d1), d1);
+		const L::Type rightWall = L::CmpGe(L::Add(p1, radius), limit);
+		d1 = L::Select(rightWall, L::Or(signBit, d1), d1);
+		const L::Type changed = L::Or(hitMask, L::Or(leftWall, rightWall));
+		const L::Type p2 = L::Select(changed, L::Add(p1, L::Div(L::Mul(L::Mul(d1, delta), speed), steps)), p1);
+		const L::Type aliveMask = simd::MaskFromBits(aliveBits);
+		L::Store(pos + i, L::Select(aliveMask, p2, p0));
+		L::Store(dir + i, L::Select(aliveMask, d1, d0));
+
+		for (int l = 0; l < W; l++)
+			if (found & (1 << l))
+			{
+				BallHit hit;
+				hit.ball = i + l;
+				hit.tileX = static_cast<int>(cellX[l]) + hitTile[l] / 3 - 1;
+				hit.tileY = static_cast<int>(cellY[l]) + hitTile[l] % 3 - 1;
+				hit.owner = map(hit.tileX, hit.tileY);
+				hits.push_back(hit);
+			}
+	}
+#endif
+	for (; i < end; i++)
+		if (balls.alive[i])
+			SweepBall(balls, i, horizontal, params, map, hits);
+}
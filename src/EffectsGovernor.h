@@ -0,0 +1,77 @@
+// Picks how much effect work a frame can afford. When the smoothed frame
+// time goes over the budget the level goes up (fewer effects) right away,
+// it only comes back down after the frames have stayed well under budget
+// for a while, so the quality does not flicker around the limit.
+
+#pragma once
+#include <SFML/System.hpp>
+#include <algorithm>
+
+class EffectsGovernor
+{
+public:
+	/// <summary>
+	/// Frame time to stay under, zero turns the governor off.
+	/// levels is the number of quality levels, level 0 is full quality.
+	/// </summary>
+	void create(const sf::Time& newBudget, int newLevels)
+	{
+		budget = newBudget.asSeconds();
+		levels = std::max(newLevels, 1);
+		level = 0;
+		average = 0;
+		cooldown = 0;
+		calm = 0;
+	}
+	int getLevel() const
+	{
+		return level;
+	}
+
+	/// <summary>
+	/// Feeds the time the last frame spent working, without the wait for
+	/// vsync. Returns true when the level changed.
+	/// </summary>
+	bool update(const sf::Time& busy)
+	{
+		if (budget <= 0)
+			return false;
+		average += (busy.asSeconds() - average) * Smoothing;
+		if (cooldown > 0)
+		{
+			cooldown--;
+			return false;
+		}
+		if (average > budget && level + 1 < levels)
+		{
+			level++;
+			calm = 0;
+			cooldown = SettleFrames;
+			return true;
+		}
+		//restoring needs a long stretch of real headroom
+		if (average < budget * RestoreFraction)
+			calm++;
+		else
+			calm = 0;
+		if (calm >= RestoreFrames && level > 0)
+		{
+			level--;
+			calm = 0;
+			cooldown = SettleFrames;
+			return true;
+		}
+		return false;
+	}
+private:
+	static constexpr float Smoothing = 0.1f;
+	static constexpr float RestoreFraction = 0.7f;
+	static constexpr int SettleFrames = 30;
+	static constexpr int RestoreFrames = 180;
+	float budget = 0;
+	int levels = 1;
+	int level = 0;
+	float average = 0;
+	int cooldown = 0;
+	int calm = 0;
+};
@@ -0,0 +1,256 @@
+// Writes rendered frames out on worker threads, as a numbered image
+// sequence or as raw I420 video to a file or pipe, so the compression of a
+// frame overlaps with the simulation and drawing of the next ones. The
+// frames wait in a fixed set of buffers that are reused for the whole run.
+
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+class FrameEncoder
+{
+public:
+	enum class Format
+	{
+		Images,
+		Yuv
+	};
+	~FrameEncoder()
+	{
+		close();
+	}
+
+	/// <summary>
+	/// Starts the workers. A path ending in .yuv or "-" (standard output)
+	/// gets raw I420 frames, anything else an image sequence with the frame
+	/// number before the extension, in the formats sf::Image can save.
+	/// Raw video is written by a single worker to keep the frames in order.
+	/// </summary>
+	/// <param name="threads">Number of image workers, 0 leaves one core for rendering</param>
+	bool open(const std::string& newPath, const sf::Vector2u& newSize, unsigned int threads = 0)
+	{
+		close();
+		path = newPath;
+		size = newSize;
+		frameCount = 0;
+		failed = false;
+		quit = false;
+		const size_t dot = path.find_last_of('.');
+		const bool hasExtension = dot != std::string::npos && path.find_first_of("/\\", dot) == std::string::npos;
+		const std::string extension = hasExtension ? path.substr(dot) : "";
+		format = path == "-" || extension == ".yuv" ? Format::Yuv : Format::Images;
+		if (format == Format::Yuv)
+		{
+			if (path == "-")
+			{
+#ifdef _WIN32
+				_setmode(_fileno(stdout), _O_BINARY);
+#endif
+				file = stdout;
+			}
+			else
+				file = std::fopen(path.c_str(), "wb");
+			if (!file)
+				return false;
+			threads = 1;
+		}
+		else
+		{
+			prefix = hasExtension ? path.substr(0, dot) : path;
+			suffix = hasExtension ? extension : ".png";
+			if (threads == 0)
+				threads = std::max(2u, std::thread::hardware_concurrency()) - 1;
+		}
+		//one frame in every worker, one waiting and one being filled
+		frames.assign(threads + 2, Frame());
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			frames[i].pixels.resize(static_cast<size_t>(size.x) * size.y * 4);
+			spare.push_back(i);
+		}
+		for (unsigned int i = 0; i < threads; i++)
+			workers.emplace_back([this]() { WorkerLoop(); });
+		return true;
+	}
+	Format getFormat() const
+	{
+		return format;
+	}
+	int getFrameCount() const
+	{
+		return frameCount;
+	}
+
+	/// <summary>
+	/// Queues a frame of RGBA pixels, rows from the bottom up when bottomUp
+	/// is set. Only blocks when every buffer is still waiting to be written.
+	/// A null frame counts as a failed write.
+	/// </summary>
+	void submit(const sf::Uint8* pixels, bool bottomUp)
+	{
+		if (!pixels)
+		{
+			failed = true;
+			frameCount++;
+			return;
+		}
+		size_t index;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			freed.wait(lock, [this]() { return !spare.empty(); });
+			index = spare.back();
+			spare.pop_back();
+		}
+		Frame& frame = frames[index];
+		std::memcpy(frame.pixels.data(), pixels, frame.pixels.size());
+		frame.bottomUp = bottomUp;
+		frame.number = frameCount++;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queue.push_back(index);
+		}
+		queued.notify_one();
+	}
+
+	/// <summary>
+	/// Writes the frames still queued and stops the workers. Returns whether
+	/// every frame was written.
+	/// </summary>
+	bool close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+		queued.notify_all();
+		for (auto& n : workers)
+			n.join();
+		workers.clear();
+		frames.clear();
+		spare.clear();
+		queue.clear();
+		if (file)
+		{
+			if (std::fflush(file) != 0)
+				failed = true;
+			if (file != stdout && std::fclose(file) != 0)
+				failed = true;
+			file = nullptr;
+		}
+		return !failed;
+	}
+private:
+	struct Frame
+	{
+		std::vector<sf::Uint8> pixels;
+		bool bottomUp = false;
+		int number = 0;
+	};
+
+	void WorkerLoop()
+	{
+		sf::Image image;
+		std::vector<sf::Uint8> planes;
+		while (true)
+		{
+			size_t index;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				queued.wait(lock, [this]() { return quit || !queue.empty(); });
+				if (queue.empty())
+					return;
+				index = queue.front();
+				queue.pop_front();
+			}
+			const Frame& frame = frames[index];
+			const bool written = format == Format::Yuv ? WriteYuv(frame, planes) : WriteImage(frame, image);
+			if (!written)
+				failed = true;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				spare.push_back(index);
+			}
+			freed.notify_one();
+		}
+	}
+	bool WriteImage(const Frame& frame, sf::Image& image) const
+	{
+		image.create(size.x, size.y, frame.pixels.data());
+		if (frame.bottomUp)
+			image.flipVertically();
+		char number[16];
+		std::snprintf(number, sizeof(number), "%05d", frame.number);
+		return image.saveToFile(prefix + number + suffix);
+	}
+	/// <summary>
+	/// BT.601 limited range, the chroma is the average of each 2x2 block.
+	/// </summary>
+	bool WriteYuv(const Frame& frame, std::vector<sf::Uint8>& planes) const
+	{
+		const unsigned int width = size.x;
+		const unsigned int height = size.y;
+		const unsigned int chromaWidth = (width + 1) / 2;
+		const unsigned int chromaHeight = (height + 1) / 2;
+		planes.resize(static_cast<size_t>(width) * height + static_cast<size_t>(chromaWidth) * chromaHeight * 2);
+		sf::Uint8* luma = planes.data();
+		sf::Uint8* u = luma + static_cast<size_t>(width) * height;
+		sf::Uint8* v = u + static_cast<size_t>(chromaWidth) * chromaHeight;
+		auto row = [&](unsigned int y)
+		{
+			return &frame.pixels[static_cast<size_t>(frame.bottomUp ? height - 1 - y : y) * width * 4];
+		};
+		for (unsigned int y = 0; y < height; y++)
+		{
+			const sf::Uint8* p = row(y);
+			for (unsigned int x = 0; x < width; x++, p += 4)
+				luma[static_cast<size_t>(y) * width + x] = static_cast<sf::Uint8>(((66 * p[0] + 129 * p[1] + 25 * p[2] + 128) >> 8) + 16);
+		}
+		for (unsigned int y = 0; y < chromaHeight; y++)
+		{
+			const sf::Uint8* top = row(y * 2);
+			const sf::Uint8* bottom = row(std::min(y * 2 + 1, height - 1));
+			for (unsigned int x = 0; x < chromaWidth; x++)
+			{
+				const size_t left = static_cast<size_t>(x) * 2 * 4;
+				const size_t right = static_cast<size_t>(std::min(x * 2 + 1, width - 1)) * 4;
+				int rgb[3];
+				for (int c = 0; c < 3; c++)
+					rgb[c] = (top[left + c] + top[right + c] + bottom[left + c] + bottom[right + c] + 2) / 4;
+				const size_t index = static_cast<size_t>(y) * chromaWidth + x;
+				u[index] = static_cast<sf::Uint8>(((-38 * rgb[0] - 74 * rgb[1] + 112 * rgb[2] + 128) >> 8) + 128);
+				v[index] = static_cast<sf::Uint8>(((112 * rgb[0] - 94 * rgb[1] - 18 * rgb[2] + 128) >> 8) + 128);
+			}
+		}
+		return std::fwrite(planes.data(), 1, planes.size(), file) == planes.size();
+	}
+
+	std::string path;
+	std::string prefix;
+	std::string suffix;
+	sf::Vector2u size;
+	Format format = Format::Images;
+	std::FILE* file = nullptr;
+	std::vector<Frame> frames;
+	std::vector<size_t> spare;
+	std::deque<size_t> queue;
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable queued;
+	std::condition_variable freed;
+	std::atomic<bool> failed{false};
+	int frameCount = 0;
+	bool quit = false;
+};
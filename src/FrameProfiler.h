@@ -0,0 +1,165 @@
+// Records how long every phase of a frame takes into a fixed ring of
+// samples, for finding out where frame drops come from. The ring can be
+// written out as a Chrome trace (chrome://tracing or ui.perfetto.dev) or
+// summarized into p50/p99 times per phase.
+
+#pragma once
+#include <SFML/System.hpp>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <ostream>
+#include <iomanip>
+#include <filesystem>
+
+class FrameProfiler
+{
+public:
+	enum class Phase : sf::Uint8
+	{
+		Frame,
+		Events,
+		Snow,
+		Ticks,
+		/// <summary>
+		/// Recorded where the trails update, nested inside Ticks rather than after it.
+		/// </summary>
+		Trails,
+		Upload,
+		WallBreak,
+		Estimate,
+		DrawSnow,
+		DrawTiles,
+		DrawParticles,
+		DrawBalls,
+		DrawHud,
+		Display,
+		Count
+	};
+	struct Sample
+	{
+		sf::Uint64 begin;
+		sf::Uint64 end;
+		Phase phase;
+	};
+	/// <summary>
+	/// Number of samples kept, about 5000 frames of every phase.
+	/// </summary>
+	static constexpr size_t Capacity = 1 << 16;
+
+	FrameProfiler()
+		: samples(Capacity), start(std::chrono::steady_clock::now())
+	{
+	}
+	static const char* name(Phase phase)
+	{
+		static const char* names[] = { "Frame", "Events", "Snow", "Ticks", "Trails", "Upload", "WallBreak", "Estimate", "DrawSnow", "DrawTiles",
+			"DrawParticles", "DrawBalls", "DrawHud", "Display" };
+		return names[static_cast<int>(phase)];
+	}
+
+	/// <summary>
+	/// Nanoseconds since the profiler was created.
+	/// </summary>
+	sf::Uint64 now() const
+	{
+		return static_cast<sf::Uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+	}
+	/// <summary>
+	/// Adds a sample. There is a single writer, it never waits and the
+	/// oldest sample is overwritten once the ring is full.
+	/// </summary>
+	void record(Phase phase, sf::Uint64 begin, sf::Uint64 end)
+	{
+		const sf::Uint64 index = head.load(std::memory_order_relaxed);
+		samples[index & (Capacity - 1)] = Sample{ begin, end, phase };
+		head.store(index + 1, std::memory_order_release);
+	}
+	/// <summary>
+	/// Records the phase from begin until now and returns now, so phases
+	/// that follow each other can be chained.
+	/// </summary>
+	sf::Uint64 lap(Phase phase, sf::Uint64 begin)
+	{
+		const sf::Uint64 end = now();
+		record(phase, begin, end);
+		return end;
+	}
+
+	/// <summary>
+	/// Copies the samples in the ring, oldest first. A copy taken on another
+	/// thread than the writer may contain a few samples from the next lap.
+	/// </summary>
+	void snapshot(std::vector<Sample>& out) const
+	{
+		const sf::Uint64 end = head.load(std::memory_order_acquire);
+		const sf::Uint64 begin = end > Capacity ? end - Capacity : 0;
+		out.clear();
+		out.reserve(static_cast<size_t>(end - begin));
+		for (sf::Uint64 i = begin; i < end; i++)
+			out.push_back(samples[i & (Capacity - 1)]);
+	}
+
+	/// <summary>
+	/// Writes the samples in the ring as a Chrome trace.
+	/// </summary>
+	/// <param name="fileName">Path of the json file to write</param>
+	bool saveTrace(const std::filesystem::path& fileName) const
+	{
+		std::vector<Sample> copy;
+		snapshot(copy);
+		std::ofstream file(fileName);
+		if (!file.is_open())
+			return false;
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		file << std::fixed << std::setprecision(3);
+		for (size_t i = 0; i < copy.size(); i++)
+		{
+			const Sample& n = copy[i];
+			file << (i == 0 ? "\n" : ",\n") << "{\"name\":\"" << name(n.phase) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":"
+				<< n.begin / 1000.0 << ",\"dur\":" << (n.end - n.begin) / 1000.0 << "}";
+		}
+		file << "\n]}\n";
+		return static_cast<bool>(file);
+	}
+
+	/// <summary>
+	/// Prints the median and 99th percentile of every phase over the
+	/// samples in the ring, in milliseconds.
+	/// </summary>
+	void summary(std::ostream& out) const
+	{
+		std::vector<Sample> copy;
+		snapshot(copy);
+		std::array<std::vector<double>, static_cast<size_t>(Phase::Count)> times;
+		for (auto& n : copy)
+			times[static_cast<size_t>(n.phase)].push_back((n.end - n.begin) / 1e6);
+		const std::ios_base::fmtflags flags = out.flags();
+		const std::streamsize precision = out.precision();
+		out << std::fixed << std::setprecision(3);
+		for (size_t p = 0; p < times.size(); p++)
+		{
+			std::vector<double>& n = times[p];
+			if (n.empty())
+				continue;
+			out << std::setw(14) << std::left << name(static_cast<Phase>(p)) << std::right << " p50 " << std::setw(8) << Percentile(n, 0.5)
+				<< " ms  p99 " << std::setw(8) << Percentile(n, 0.99) << " ms  (" << n.size() << ")\n";
+		}
+		out.flags(flags);
+		out.precision(precision);
+	}
+private:
+	static double Percentile(std::vector<double>& values, double fraction)
+	{
+		const size_t k = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+		std::nth_element(values.begin(), values.begin() + k, values.end());
+		return values[k];
+	}
+
+	std::vector<Sample> samples;
+	std::atomic<sf::Uint64> head{0};
+	std::chrono::steady_clock::time_point start;
+};
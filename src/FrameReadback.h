@@ -0,0 +1,137 @@
+// Reads rendered frames back from a render texture without waiting for the
+// GPU. Every frame is copied into one of a ring of pixel buffer objects and
+// only mapped a few frames later, when the copy has long finished. Without
+// pixel buffers (GLES, very old drivers) it falls back to copyToImage.
+
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <SFML/OpenGL.hpp>
+#include <vector>
+#include <cstddef>
+
+#ifdef _WIN32
+#define READBACK_APIENTRY __stdcall
+#else
+#define READBACK_APIENTRY
+#endif
+
+class FrameReadback
+{
+public:
+	/// <summary>
+	/// Sets up depth buffers for the frames of target. The higher the depth,
+	/// the more frames the GPU may be behind before a read has to wait.
+	/// </summary>
+	void create(sf::RenderTexture& newTarget, int depth = 3)
+	{
+		target = &newTarget;
+		size = target->getSize();
+		depth = depth < 1 ? 1 : depth;
+		issued = 0;
+		mapped = 0;
+		buffers.clear();
+		if (!target->setActive(true))
+			return;
+		//the buffer functions are not part of OpenGL 1.1, they are loaded through SFML
+		if (!Load(readPixels, "glReadPixels") || !Load(genBuffers, "glGenBuffers") || !Load(deleteBuffers, "glDeleteBuffers")
+			|| !Load(bindBuffer, "glBindBuffer") || !Load(bufferData, "glBufferData") || !Load(mapBuffer, "glMapBuffer")
+			|| !Load(unmapBuffer, "glUnmapBuffer"))
+			return;
+		const std::ptrdiff_t bytes = static_cast<std::ptrdiff_t>(size.x) * size.y * 4;
+		buffers.resize(depth);
+		genBuffers(depth, buffers.data());
+		for (auto n : buffers)
+		{
+			bindBuffer(PixelPackBuffer, n);
+			bufferData(PixelPackBuffer, bytes, nullptr, StreamRead);
+		}
+		bindBuffer(PixelPackBuffer, 0);
+	}
+	/// <summary>
+	/// Whether frames go through pixel buffers or are read synchronously.
+	/// </summary>
+	bool isAsync() const
+	{
+		return !buffers.empty();
+	}
+
+	/// <summary>
+	/// Starts reading the frame that was just displayed on the target. Once
+	/// depth frames are in flight the oldest one is handed to
+	/// ready(pixels, bottomUp), the pixels are only valid during the call.
+	/// </summary>
+	template<typename Func>
+	void push(Func&& ready)
+	{
+		if (!isAsync())
+		{
+			const sf::Image image = target->getTexture().copyToImage();
+			ready(image.getPixelsPtr(), false);
+			return;
+		}
+		target->setActive(true);
+		if (issued - mapped == buffers.size())
+			Map(ready);
+		bindBuffer(PixelPackBuffer, buffers[issued % buffers.size()]);
+		readPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		bindBuffer(PixelPackBuffer, 0);
+		issued++;
+	}
+	/// <summary>
+	/// Hands over the frames still in flight and frees the buffers.
+	/// </summary>
+	template<typename Func>
+	void finish(Func&& ready)
+	{
+		if (!isAsync())
+			return;
+		target->setActive(true);
+		while (mapped < issued)
+			Map(ready);
+		deleteBuffers(static_cast<GLsizei>(buffers.size()), buffers.data());
+		buffers.clear();
+	}
+private:
+	using ReadPixels = void (READBACK_APIENTRY*)(GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, void*);
+	using GenBuffers = void (READBACK_APIENTRY*)(GLsizei, GLuint*);
+	using DeleteBuffers = void (READBACK_APIENTRY*)(GLsizei, const GLuint*);
+	using BindBuffer = void (READBACK_APIENTRY*)(GLenum, GLuint);
+	using BufferData = void (READBACK_APIENTRY*)(GLenum, std::ptrdiff_t, const void*, GLenum);
+	using MapBuffer = void* (READBACK_APIENTRY*)(GLenum, GLenum);
+	using UnmapBuffer = GLboolean (READBACK_APIENTRY*)(GLenum);
+	static constexpr GLenum PixelPackBuffer = 0x88EB;
+	static constexpr GLenum StreamRead = 0x88E1;
+	static constexpr GLenum ReadOnly = 0x88B8;
+
+	template<typename T>
+	static bool Load(T& func, const char* name)
+	{
+		func = reinterpret_cast<T>(sf::Context::getFunction(name));
+		return func != nullptr;
+	}
+	template<typename Func>
+	void Map(Func&& ready)
+	{
+		bindBuffer(PixelPackBuffer, buffers[mapped % buffers.size()]);
+		//a failed map still reaches ready, as null, so the frame is not silently dropped
+		const void* pixels = mapBuffer(PixelPackBuffer, ReadOnly);
+		ready(static_cast<const sf::Uint8*>(pixels), true);
+		if (pixels)
+			unmapBuffer(PixelPackBuffer);
+		bindBuffer(PixelPackBuffer, 0);
+		mapped++;
+	}
+
+	sf::RenderTexture* target = nullptr;
+	sf::Vector2u size;
+	std::vector<GLuint> buffers;
+	size_t issued = 0;
+	size_t mapped = 0;
+	ReadPixels readPixels = nullptr;
+	GenBuffers genBuffers = nullptr;
+	DeleteBuffers deleteBuffers = nullptr;
+	BindBuffer bindBuffer = nullptr;
+	BufferData bufferData = nullptr;
+	MapBuffer mapBuffer = nullptr;
+	UnmapBuffer unmapBuffer = nullptr;
+};
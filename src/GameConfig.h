@@ -0,0 +1,265 @@
+// Text settings file read at startup, so a single build can be set up per
+// venue. One "key = value" per line, # starts a comment. Keys that are left
+// out keep their defaults and unknown keys are reported and skipped.
+
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <filesystem>
+#include <type_traits>
+#include <cmath>
+#include "Simulation.h"
+
+struct GameConfig
+{
+	/// <summary>
+	/// Ball count, teams, map, ball speed and the timer, the seed stays on the command line.
+	/// </summary>
+	MatchSettings match;
+	/// <summary>
+	/// Steer the first three balls with WASD, IJKL and the numpad.
+	/// </summary>
+	bool controllable = false;
+	/// <summary>
+	/// Rotate the team colors every swapColorsInterval.
+	/// </summary>
+	bool swapColors = false;
+	sf::Time swapColorsInterval = sf::seconds(40);
+	/// <summary>
+	/// Kiosk mode, the window ignores Escape and close requests.
+	/// </summary>
+	bool borna = false;
+	/// <summary>
+	/// Tile shader and falling snow.
+	/// </summary>
+	bool fancy = true;
+	/// <summary>
+	/// Draw the tiles as one quad over an ownership texture when the GPU
+	/// allows it, instead of six vertices per tile.
+	/// </summary>
+	bool tileTexture = true;
+	/// <summary>
+	/// Frame time the effects are scaled down to stay under, zero keeps them all.
+	/// </summary>
+	sf::Time frameBudget = sf::milliseconds(14);
+	/// <summary>
+	/// Show the chance of every team to win under its counter, estimated
+	/// from winRollouts random continuations of winHorizon each.
+	/// </summary>
+	bool winEstimate = false;
+	int winRollouts = 256;
+	sf::Time winHorizon = sf::seconds(30);
+	/// <summary>
+	/// One color per team, teams past the end reuse them from the start.
+	/// </summary>
+	std::vector<sf::Color> ballColors = { sf::Color(255, 50, 40), sf::Color(0x5AFFFFFF), sf::Color(242, 174, 14), sf::Color(5, 107, 14) };
+	/// <summary>
+	/// Tile color per owner, the first one is for tiles nobody owns.
+	/// </summary>
+	std::vector<sf::Color> tileColors = { sf::Color(0, 0, 0), sf::Color(200, 30, 0), sf::Color(0x99E6E6FF), sf::Color(207, 154, 10), sf::Color(11, 87, 18) };
+
+	/// <summary>
+	/// Loads the settings from a file, returns false if it could not be opened.
+	/// </summary>
+	/// <param name="fileName">Path of the config file to load</param>
+	bool loadFromFile(const std::filesystem::path& fileName)
+	{
+		sf::FileInputStream load1;
+		if (load1.open(fileName.string()))
+			return loadFromStream(load1);
+		return false;
+	}
+
+	/// <summary>
+	/// Loads the settings from config text held in memory.
+	/// </summary>
+	bool loadFromMemory(const std::string& data, sf::Uint64 size)
+	{
+		sf::MemoryInputStream stream;
+		stream.open(data.c_str(), size);
+		return loadFromStream(stream);
+	}
+
+	/// <summary>
+	/// This function is used by loadFromFile() as well
+	/// as loadFromMemory() to load config data.
+	/// </summary>
+	bool loadFromStream(sf::InputStream& stream)
+	{
+		const sf::Int64 size = stream.getSize();
+		if (size < 0)
+			return false;
+		std::string text(static_cast<size_t>(size), '\0');
+		if (size > 0 && stream.read(&text[0], size) != size)
+			return false;
+		std::istringstream lines(text);
+		std::string line;
+		int lineNumber = 0;
+		while (std::getline(lines, line))
+		{
+			lineNumber++;
+			line = line.substr(0, line.find('#'));
+			const size_t split = line.find('=');
+			const std::string key = Trim(line.substr(0, split));
+			if (key.empty())
+				continue;
+			if (split == std::string::npos || !Apply(key, Trim(line.substr(split + 1))))
+				sf::err() << "Config line " << lineNumber << ": could not read \"" << key << "\"" << std::endl;
+		}
+		return true;
+	}
+private:
+	static std::string Trim(const std::string& text)
+	{
+		const size_t begin = text.find_first_not_of(" \t\r");
+		if (begin == std::string::npos)
+			return "";
+		return text.substr(begin, text.find_last_not_of(" \t\r") - begin + 1);
+	}
+	static bool ReadBool(const std::string& value, bool& out)
+	{
+		if (value == "1" || value == "true" || value == "on")
+			out = true;
+		else if (value == "0" || value == "false" || value == "off")
+			out = false;
+		else
+			return false;
+		return true;
+	}
+	/// <summary>
+	/// Whole value as a number. Unsigned fields reject a sign instead of
+	/// wrapping it around and floats have to be finite.
+	/// </summary>
+	template<typename T>
+	static bool ReadNumber(const std::string& value, T& out)
+	{
+		if (std::is_unsigned<T>::value && value.find('-') != std::string::npos)
+			return false;
+		std::istringstream stream(value);
+		T read;
+		if (!(stream >> read) || !(stream >> std::ws).eof())
+			return false;
+		if (std::is_floating_point<T>::value && !std::isfinite(static_cast<double>(read)))
+			return false;
+		out = read;
+		return true;
+	}
+	/// <summary>
+	/// Number above zero, out keeps its value otherwise.
+	/// </summary>
+	template<typename T>
+	static bool ReadPositive(const std::string& value, T& out)
+	{
+		T read;
+		if (!ReadNumber(value, read) || !(read > 0))
+			return false;
+		out = read;
+		return true;
+	}
+	/// <summary>
+	/// Hex colors as RRGGBB or RRGGBBAA, separated by spaces or commas.
+	/// </summary>
+	static bool ReadColors(std::string value, std::vector<sf::Color>& out)
+	{
+		for (auto& n : value)
+			if (n == ',')
+				n = ' ';
+		std::istringstream stream(value);
+		std::vector<sf::Color> colors;
+		std::string hex;
+		while (stream >> hex)
+		{
+			if (!hex.empty() && hex[0] == '#')
+				hex.erase(0, 1);
+			if ((hex.size() != 6 && hex.size() != 8) || hex.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+				return false;
+			sf::Uint32 rgba = static_cast<sf::Uint32>(std::stoul(hex, nullptr, 16));
+			if (hex.size() == 6)
+				rgba = rgba << 8 | 0xFF;
+			colors.emplace_back(rgba);
+		}
+		if (colors.empty())
+			return false;
+		out = colors;
+		return true;
+	}
+	bool Apply(const std::string& key, const std::string& value)
+	{
+		if (key == "timer")
+			return ReadBool(value, match.timerMode);
+		if (key == "timerLength")
+		{
+			float length = 0;
+			if (!ReadNumber(value, length) || length <= 0)
+				return false;
+			match.timerLength = sf::seconds(length);
+			return true;
+		}
+		if (key == "controllable")
+			return ReadBool(value, controllable);
+		if (key == "swapColors")
+			return ReadBool(value, swapColors);
+		if (key == "swapColorsInterval")
+		{
+			float interval = 0;
+			if (!ReadNumber(value, interval) || interval <= 0)
+				return false;
+			swapColorsInterval = sf::seconds(interval);
+			return true;
+		}
+		if (key == "borna")
+			return ReadBool(value, borna);
+		if (key == "fancy")
+			return ReadBool(value, fancy);
+		if (key == "tileTexture")
+			return ReadBool(value, tileTexture);
+		if (key == "frameBudget")
+		{
+			float budget = 0;
+			if (!ReadNumber(value, budget) || budget < 0)
+				return false;
+			frameBudget = sf::seconds(budget / 1000);
+			return true;
+		}
+		if (key == "winEstimate")
+			return ReadBool(value, winEstimate);
+		if (key == "winRollouts")
+			return ReadPositive(value, winRollouts);
+		if (key == "winHorizon")
+		{
+			float horizon = 0;
+			if (!ReadNumber(value, horizon) || horizon <= 0)
+				return false;
+			winHorizon = sf::seconds(horizon);
+			return true;
+		}
+		if (key == "balls")
+			return ReadPositive(value, match.ballCount);
+		if (key == "teams")
+			return ReadPositive(value, match.teamCount);
+		if (key == "ballSpeed")
+			return ReadPositive(value, match.ballSpeed);
+		if (key == "tileLength")
+			return ReadPositive(value, match.tileLength);
+		if (key == "ballCollisions")
+			return ReadBool(value, match.ballCollisions);
+		if (key == "map")
+		{
+			//WIDTHxHEIGHT in tiles
+			const size_t split = value.find('x');
+			sf::Vector2u size;
+			if (split == std::string::npos || !ReadNumber(value.substr(0, split), size.x) || !ReadNumber(value.substr(split + 1), size.y)
+				|| size.x == 0 || size.y == 0)
+				return false;
+			match.mapSize = size;
+			return true;
+		}
+		if (key == "ballColors")
+			return ReadColors(value, ballColors);
+		if (key == "tileColors")
+			return ReadColors(value, tileColors);
+		return false;
+	}
+};
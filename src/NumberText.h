@@ -0,0 +1,249 @@
+// Numeric labels drawn from glyphs baked once at startup. Every label has a
+// fixed number of quads in one shared vertex array, so changing a value only
+// rewrites its own vertices and all labels are drawn with a single call.
+
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <string>
+#include <array>
+#include <algorithm>
+
+class NumberText : public sf::Drawable
+{
+public:
+	enum class Align
+	{
+		Left,
+		Center,
+		Right
+	};
+
+	/// <summary>
+	/// Rasterizes the digits, '.' and the prefix and suffix characters at characterSize.
+	/// Labels of other sizes are scaled from these glyphs, so they share one
+	/// texture page.
+	/// </summary>
+	void create(const sf::Font& newFont, unsigned int newCharacterSize, float newOutlineThickness, const sf::Color& newOutlineColor, const std::string& extraCharacters = "")
+	{
+		font = &newFont;
+		characterSize = newCharacterSize;
+		outlineThickness = newOutlineThickness;
+		outlineColor = newOutlineColor;
+		fields.clear();
+		vertices.clear();
+		vertices.setPrimitiveType(sf::Triangles);
+		baked.fill(false);
+		const std::string characters = "0123456789." + extraCharacters;
+		for (char c : characters)
+		{
+			const int index = static_cast<unsigned char>(c) & 127;
+			glyphs[index] = font->getGlyph(c, characterSize, false);
+			outlineGlyphs[index] = font->getGlyph(c, characterSize, false, outlineThickness);
+			baked[index] = true;
+		}
+	}
+
+	/// <summary>
+	/// Adds a label and returns its index. It holds up to capacity characters
+	/// between the prefix and the suffix and starts hidden until a value is set.
+	/// </summary>
+	int addField(const sf::Vector2f& position, float size, const sf::Color& color, Align align, int capacity = 10, const std::string& prefix = "", const std::string& suffix = "")
+	{
+		Field field;
+		field.position = position;
+		field.scale = size / characterSize;
+		field.color = color;
+		field.align = align;
+		field.prefix = prefix.substr(0, MaxPrefix);
+		field.suffix = suffix.substr(0, MaxPrefix);
+		field.capacity = capacity + static_cast<int>(field.prefix.size() + field.suffix.size());
+		field.firstVertex = vertices.getVertexCount();
+		vertices.resize(vertices.getVertexCount() + static_cast<size_t>(field.capacity) * 12);
+		fields.push_back(field);
+		return static_cast<int>(fields.size()) - 1;
+	}
+
+	/// <summary>
+	/// Shows value, with the last decimals digits after a '.'.
+	/// Nothing is rewritten when the value did not change.
+	/// </summary>
+	void setValue(int index, long long value, int decimals = 0)
+	{
+		Field& field = fields[index];
+		if (field.hasValue && field.value == value && field.decimals == decimals)
+			return;
+		field.hasValue = true;
+		field.value = value;
+		field.decimals = decimals;
+		Rebuild(field);
+	}
+	void setColor(int index, const sf::Color& color)
+	{
+		Field& field = fields[index];
+		if (field.color == color)
+			return;
+		field.color = color;
+		Rebuild(field);
+	}
+	void setOutline(int index, bool outline)
+	{
+		Field& field = fields[index];
+		if (field.outline == outline)
+			return;
+		field.outline = outline;
+		Rebuild(field);
+	}
+	void setVisible(int index, bool visible)
+	{
+		Field& field = fields[index];
+		if (field.visible == visible)
+			return;
+		field.visible = visible;
+		Rebuild(field);
+	}
+private:
+	struct Field
+	{
+		sf::Vector2f position;
+		float scale = 1;
+		sf::Color color;
+		Align align = Align::Left;
+		std::string prefix;
+		std::string suffix;
+		int capacity = 0;
+		size_t firstVertex = 0;
+		long long value = 0;
+		int decimals = 0;
+		bool hasValue = false;
+		bool outline = false;
+		bool visible = true;
+	};
+
+	/// <summary>
+	/// Writes the characters of the field into its quads, outlines in the
+	/// first half so the fill is drawn on top. Unused quads are collapsed.
+	/// </summary>
+	void Rebuild(const Field& field)
+	{
+		char text[48];
+		int length = 0;
+		if (field.visible && field.hasValue)
+		{
+			for (char c : field.prefix)
+				text[length++] = c;
+			char digits[24];
+			int count = 0;
+			unsigned long long magnitude = field.value < 0 ? 0ULL - static_cast<unsigned long long>(field.value) : field.value;
+			do
+			{
+				if (count == field.decimals && count > 0)
+					digits[count++] = '.';
+				digits[count++] = static_cast<char>('0' + magnitude % 10);
+				magnitude /= 10;
+			} while (magnitude > 0 || count <= field.decimals);
+			if (field.value < 0)
+				digits[count++] = '-';
+			while (count > 0)
+				text[length++] = digits[--count];
+			for (char c : field.suffix)
+				text[length++] = c;
+			length = std::min(length, field.capacity);
+		}
+		//sf::Text places the baseline at the character size and the labels are
+		//aligned on the bounds of their fill glyphs
+		float x = 0;
+		sf::FloatRect bounds(0, 0, 0, 0);
+		float right = 0;
+		float bottom = 0;
+		for (int i = 0; i < length; i++)
+		{
+			const sf::Glyph& glyph = glyphs[static_cast<unsigned char>(text[i]) & 127];
+			const float top = characterSize + glyph.bounds.top;
+			if (i == 0)
+			{
+				bounds.left = x + glyph.bounds.left;
+				bounds.top = top;
+			}
+			bounds.left = std::min(bounds.left, x + glyph.bounds.left);
+			bounds.top = std::min(bounds.top, top);
+			right = std::max(right, x + glyph.bounds.left + glyph.bounds.width);
+			bottom = std::max(bottom, top + glyph.bounds.height);
+			x += glyph.advance;
+		}
+		bounds.width = right - bounds.left;
+		bounds.height = bottom - bounds.top;
+		sf::Vector2f origin;
+		if (field.align == Align::Center)
+			origin = sf::Vector2f(bounds.width / 2, bounds.height / 2);
+		else if (field.align == Align::Right)
+			origin = sf::Vector2f(bounds.width, 0);
+		const sf::Vector2f start = field.position - origin * field.scale;
+
+		sf::Vertex* outline = &vertices[field.firstVertex];
+		sf::Vertex* fill = outline + static_cast<size_t>(field.capacity) * 6;
+		x = 0;
+		for (int i = 0; i < field.capacity; i++)
+		{
+			if (i >= length)
+			{
+				Collapse(outline + i * 6);
+				Collapse(fill + i * 6);
+				continue;
+			}
+			const int index = static_cast<unsigned char>(text[i]) & 127;
+			const sf::Vector2f pen = start + sf::Vector2f(x, static_cast<float>(characterSize)) * field.scale;
+			if (field.outline && baked[index])
+				Quad(outline + i * 6, pen, field.scale, outlineGlyphs[index], outlineColor);
+			else
+				Collapse(outline + i * 6);
+			if (baked[index])
+				Quad(fill + i * 6, pen, field.scale, glyphs[index], field.color);
+			else
+				Collapse(fill + i * 6);
+			x += glyphs[index].advance;
+		}
+	}
+	static void Quad(sf::Vertex* ptr, const sf::Vector2f& pen, float scale, const sf::Glyph& glyph, const sf::Color& color)
+	{
+		//same one pixel padding as sf::Text so filtering does not cut the edges
+		const float padding = 1;
+		const float left = glyph.bounds.left - padding;
+		const float top = glyph.bounds.top - padding;
+		const float right = glyph.bounds.left + glyph.bounds.width + padding;
+		const float bottom = glyph.bounds.top + glyph.bounds.height + padding;
+		const float u1 = static_cast<float>(glyph.textureRect.left) - padding;
+		const float v1 = static_cast<float>(glyph.textureRect.top) - padding;
+		const float u2 = static_cast<float>(glyph.textureRect.left + glyph.textureRect.width) + padding;
+		const float v2 = static_cast<float>(glyph.textureRect.top + glyph.textureRect.height) + padding;
+		ptr[0] = sf::Vertex(pen + sf::Vector2f(left, top) * scale, color, sf::Vector2f(u1, v1));
+		ptr[1] = sf::Vertex(pen + sf::Vector2f(right, top) * scale, color, sf::Vector2f(u2, v1));
+		ptr[2] = sf::Vertex(pen + sf::Vector2f(left, bottom) * scale, color, sf::Vector2f(u1, v2));
+		ptr[3] = ptr[2];
+		ptr[4] = ptr[1];
+		ptr[5] = sf::Vertex(pen + sf::Vector2f(right, bottom) * scale, color, sf::Vector2f(u2, v2));
+	}
+	static void Collapse(sf::Vertex* ptr)
+	{
+		for (int k = 0; k < 6; k++)
+			ptr[k].position = sf::Vector2f();
+	}
+	void draw(sf::RenderTarget& target, sf::RenderStates states) const override
+	{
+		if (!font || vertices.getVertexCount() == 0)
+			return;
+		states.texture = &font->getTexture(characterSize);
+		target.draw(vertices, states);
+	}
+
+	static constexpr size_t MaxPrefix = 8;
+	const sf::Font* font = nullptr;
+	unsigned int characterSize = 0;
+	float outlineThickness = 0;
+	sf::Color outlineColor;
+	std::array<sf::Glyph, 128> glyphs;
+	std::array<sf::Glyph, 128> outlineGlyphs;
+	std::array<bool, 128> baked{};
+	std::vector<Field> fields;
+	sf::VertexArray vertices;
+};
@@ -0,0 +1,297 @@
+// Contiguous tile ownership grid used by ToInfinity.
+// Every tile stores the index of its owner (0 = nobody, n = team n - 1).
+
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+class OwnershipGrid
+{
+public:
+	enum class Layout
+	{
+		RowMajor,
+		Tiled
+	};
+	static constexpr unsigned int BlockSize = 8;
+
+	/// <summary>
+	/// Rectangle of the grid clipped to its bounds. Coordinates passed to
+	/// it are grid coordinates and are checked against the clipped area.
+	/// </summary>
+	class Region
+	{
+		friend class OwnershipGrid;
+		OwnershipGrid* grid;
+		Region(OwnershipGrid& grid, int left, int top, int right, int bottom)
+			: grid(&grid), left(left), top(top), right(right), bottom(bottom)
+		{
+		}
+	public:
+		const int left;
+		const int top;
+		const int right;
+		const int bottom;
+
+		bool contains(int x, int y) const
+		{
+			return x >= left && x < right && y >= top && y < bottom;
+		}
+		/// <summary>
+		/// Tile at grid coordinates, nullptr outside the region.
+		/// </summary>
+		sf::Uint8* get(int x, int y) const
+		{
+			return contains(x, y) ? &(*grid)(x, y) : nullptr;
+		}
+		/// <summary>
+		/// Tile at grid coordinates that are known to be inside the region,
+		/// only checked by an assert.
+		/// </summary>
+		sf::Uint8& unchecked(int x, int y) const
+		{
+			assert(contains(x, y));
+			return (*grid)(x, y);
+		}
+		void fill(sf::Uint8 owner) const
+		{
+			for (int y = top; y < bottom; y++)
+				for (int x = left; x < right; x++)
+					(*grid)(x, y) = owner;
+		}
+		template<typename F>
+		void forEach(F&& func) const
+		{
+			//row by row, so a row-major grid is walked in memory order
+			for (int y = top; y < bottom; y++)
+				for (int x = left; x < right; x++)
+					func(x, y, (*grid)(x, y));
+		}
+	};
+
+	OwnershipGrid() {}
+	OwnershipGrid(const sf::Vector2u& size, Layout layout = Layout::RowMajor)
+	{
+		create(size, layout);
+	}
+
+	/// <summary>
+	/// Resizes the grid and marks every tile as unowned.
+	/// </summary>
+	void create(const sf::Vector2u& newSize, Layout newLayout = Layout::RowMajor)
+	{
+		size = newSize;
+		layout = newLayout;
+		if (layout == Layout::Tiled)
+		{
+			blocksX = (size.x + BlockSize - 1) / BlockSize;
+			data.assign(static_cast<size_t>(blocksX) * BlockSize * ((size.y + BlockSize - 1) / BlockSize) * BlockSize, 0);
+		}
+		else
+		{
+			blocksX = 0;
+			data.assign(static_cast<size_t>(size.x) * size.y, 0);
+		}
+	}
+	const sf::Vector2u& getSize() const
+	{
+		return size;
+	}
+	Layout getLayout() const
+	{
+		return layout;
+	}
+	bool contains(int x, int y) const
+	{
+		return x >= 0 && y >= 0 && x < static_cast<int>(size.x) && y < static_cast<int>(size.y);
+	}
+	size_t index(unsigned int x, unsigned int y) const
+	{
+		if (layout == Layout::RowMajor)
+			return static_cast<size_t>(y) * size.x + x;
+		const size_t block = static_cast<size_t>(y / BlockSize) * blocksX + x / BlockSize;
+		return block * BlockSize * BlockSize + (y % BlockSize) * BlockSize + x % BlockSize;
+	}
+	sf::Uint8& operator()(unsigned int x, unsigned int y)
+	{
+		return data[index(x, y)];
+	}
+	const sf::Uint8& operator()(unsigned int x, unsigned int y) const
+	{
+		return data[index(x, y)];
+	}
+
+	/// <summary>
+	/// Returns the part of the rectangle that lies inside the grid.
+	/// </summary>
+	Region region(const sf::IntRect& rect)
+	{
+		return Region(*this, std::max(rect.left, 0), std::max(rect.top, 0),
+			std::min(rect.left + rect.width, static_cast<int>(size.x)), std::min(rect.top + rect.height, static_cast<int>(size.y)));
+	}
+
+	void fill(sf::Uint8 owner)
+	{
+		std::fill(data.begin(), data.end(), owner);
+	}
+
+	/// <summary>
+	/// The tiles in storage order, for copying a whole grid at once.
+	/// </summary>
+	const std::vector<sf::Uint8>& getStorage() const
+	{
+		return data;
+	}
+	/// <summary>
+	/// Overwrites every tile with storage taken from a grid of the same size and layout.
+	/// </summary>
+	void setStorage(const std::vector<sf::Uint8>& storage)
+	{
+		assert(storage.size() == data.size());
+		std::copy(storage.begin(), storage.end(), data.begin());
+	}
+
+	/// <summary>
+	/// Returns how many tiles belong to the owner.
+	/// </summary>
+	size_t count(sf::Uint8 owner) const
+	{
+		if (layout == Layout::RowMajor)
+			return std::count(data.begin(), data.end(), owner);
+		size_t total = 0;
+		forEachRow([&](const sf::Uint8* row, unsigned int x, unsigned int y, unsigned int length)
+			{
+				total += std::count(row, row + length, owner);
+			});
+		return total;
+	}
+
+	/// <summary>
+	/// Counts every owner in a single pass. totals[n] receives the number of
+	/// tiles owned by n, owners past the end of totals are ignored.
+	/// </summary>
+	void countAll(std::vector<int>& totals) const
+	{
+		size_t histogram[256] = {};
+		forEachRow([&](const sf::Uint8* row, unsigned int x, unsigned int y, unsigned int length)
+			{
+				for (unsigned int i = 0; i < length; i++)
+					histogram[row[i]]++;
+			});
+		for (size_t i = 0; i < totals.size(); i++)
+			totals[i] = i < 256 ? static_cast<int>(histogram[i]) : 0;
+	}
+
+	/// <summary>
+	/// Calls func(x, y) for every tile owned by the owner, in storage order.
+	/// </summary>
+	template<typename F>
+	void forEachOwned(sf::Uint8 owner, F&& func) const
+	{
+		forEachRow([&](const sf::Uint8* row, unsigned int x, unsigned int y, unsigned int length)
+			{
+				for (unsigned int i = 0; i < length; i++)
+					if (row[i] == owner)
+						func(x + i, y);
+			});
+	}
+private:
+	/// <summary>
+	/// Walks the storage front to back as contiguous runs of tiles that
+	/// share a row, skipping the padding of edge blocks.
+	/// </summary>
+	template<typename F>
+	void forEachRow(F&& func) const
+	{
+		if (layout == Layout::RowMajor)
+		{
+			for (unsigned int y = 0; y < size.y; y++)
+				func(&data[static_cast<size_t>(y) * size.x], 0, y, size.x);
+			return;
+		}
+		const sf::Uint8* block = data.data();
+		for (unsigned int by = 0; by < size.y; by += BlockSize)
+			for (unsigned int bx = 0; bx < size.x; bx += BlockSize, block += BlockSize * BlockSize)
+			{
+				const unsigned int width = std::min(BlockSize, size.x - bx);
+				const unsigned int height = std::min(BlockSize, size.y - by);
+				for (unsigned int y = 0; y < height; y++)
+					func(block + y * BlockSize, bx, by + y, width);
+			}
+	}
+
+	std::vector<sf::Uint8> data;
+	sf::Vector2u size;
+	Layout layout = Layout::RowMajor;
+	unsigned int blocksX = 0;
+};
+
+/// <summary>
+/// Index of the tiles every owner holds, kept next to an OwnershipGrid.
+/// Each owner has a dense list of tiles and every tile remembers its place
+/// in that list, so moving a tile between owners is O(1) and walking the
+/// tiles of an owner costs only as much as it holds. Tiles of owner 0 are
+/// not listed.
+/// </summary>
+class OwnedTiles
+{
+public:
+	void create(const sf::Vector2u& newSize, int owners)
+	{
+		size = newSize;
+		lists.assign(std::max(owners, 1), std::vector<sf::Uint32>());
+		slots.assign(static_cast<size_t>(size.x) * size.y, 0);
+	}
+	/// <summary>
+	/// Moves the tile from the list of previous to the list of owner.
+	/// </summary>
+	void set(unsigned int x, unsigned int y, int previous, int owner)
+	{
+		const sf::Uint32 tile = y * size.x + x;
+		if (previous > 0)
+		{
+			std::vector<sf::Uint32>& list = lists[previous];
+			const sf::Uint32 slot = slots[tile];
+			assert(slot < list.size() && list[slot] == tile);
+			list[slot] = list.back();
+			slots[list[slot]] = slot;
+			list.pop_back();
+		}
+		if (owner > 0)
+		{
+			slots[tile] = static_cast<sf::Uint32>(lists[owner].size());
+			lists[owner].push_back(tile);
+		}
+	}
+	size_t count(int owner) const
+	{
+		return lists[owner].size();
+	}
+	/// <summary>
+	/// Tiles of the owner as y * width + x, in no particular order.
+	/// </summary>
+	const std::vector<sf::Uint32>& tiles(int owner) const
+	{
+		return lists[owner];
+	}
+	sf::Vector2i position(sf::Uint32 tile) const
+	{
+		return sf::Vector2i(static_cast<int>(tile % size.x), static_cast<int>(tile / size.x));
+	}
+	/// <summary>
+	/// Calls func(x, y) for every tile of the owner. The list must not
+	/// change from inside func.
+	/// </summary>
+	template<typename F>
+	void forEach(int owner, F&& func) const
+	{
+		for (sf::Uint32 tile : lists[owner])
+			func(tile % size.x, tile / size.x);
+	}
+private:
+	std::vector<std::vector<sf::Uint32>> lists;
+	std::vector<sf::Uint32> slots;
+	sf::Vector2u size;
+};
@@ -0,0 +1,99 @@
+// Tile map drawn as a single quad over the arena. The owner of every tile
+// is a texel of a map-sized texture and the fragment shader turns it into
+// the tile color, so a tile costs four bytes instead of six vertices and a
+// capture only updates its texel.
+
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <algorithm>
+
+class OwnershipTexture : public sf::Drawable
+{
+public:
+	/// <summary>
+	/// Whether a map of this size fits in a single texture on this GPU.
+	/// </summary>
+	static bool fits(const sf::Vector2u& mapSize)
+	{
+		return mapSize.x <= sf::Texture::getMaximumSize() && mapSize.y <= sf::Texture::getMaximumSize();
+	}
+
+	/// <summary>
+	/// Creates the texture with every tile unowned. Texture coordinates of
+	/// the quad are world positions, like the ones of the vertex tiles.
+	/// </summary>
+	bool create(const sf::Vector2u& newMapSize, const sf::Vector2f& tileSize)
+	{
+		mapSize = newMapSize;
+		if (!fits(mapSize) || !texture.create(mapSize.x, mapSize.y))
+			return false;
+		//SFML textures are always RGBA, the owner lives in the red channel
+		pixels.assign(static_cast<size_t>(mapSize.x) * mapSize.y * 4, 0);
+		for (size_t i = 3; i < pixels.size(); i += 4)
+			pixels[i] = 255;
+		texture.update(pixels.data());
+		const sf::Vector2f size = sf::Vector2f(mapSize.x * tileSize.x, mapSize.y * tileSize.y);
+		quad.setPrimitiveType(sf::TriangleStrip);
+		quad.resize(4);
+		quad[0] = sf::Vertex(sf::Vector2f(0, 0), sf::Vector2f(0, 0));
+		quad[1] = sf::Vertex(sf::Vector2f(size.x, 0), sf::Vector2f(size.x, 0));
+		quad[2] = sf::Vertex(sf::Vector2f(0, size.y), sf::Vector2f(0, size.y));
+		quad[3] = sf::Vertex(size, size);
+		dirty.clear();
+		dirtyTop = mapSize.y;
+		dirtyBottom = 0;
+		return true;
+	}
+	const sf::Texture& getTexture() const
+	{
+		return texture;
+	}
+
+	/// <summary>
+	/// Changes the owner of a tile, it reaches the GPU on the next flush.
+	/// </summary>
+	void setOwner(unsigned int x, unsigned int y, sf::Uint8 owner)
+	{
+		const size_t index = (static_cast<size_t>(y) * mapSize.x + x) * 4;
+		if (pixels[index] == owner)
+			return;
+		pixels[index] = owner;
+		dirtyTop = std::min(dirtyTop, y);
+		dirtyBottom = std::max(dirtyBottom, y + 1);
+		if (dirty.size() <= MaxTexelUpdates)
+			dirty.emplace_back(x, y);
+	}
+
+	/// <summary>
+	/// Uploads the changed texels one by one, past MaxTexelUpdates the rows
+	/// they span are uploaded in a single call instead.
+	/// </summary>
+	void flush()
+	{
+		if (dirtyTop >= dirtyBottom)
+			return;
+		if (dirty.size() <= MaxTexelUpdates)
+			for (auto& n : dirty)
+				texture.update(&pixels[(static_cast<size_t>(n.y) * mapSize.x + n.x) * 4], 1, 1, n.x, n.y);
+		else
+			texture.update(&pixels[static_cast<size_t>(dirtyTop) * mapSize.x * 4], mapSize.x, dirtyBottom - dirtyTop, 0, dirtyTop);
+		dirty.clear();
+		dirtyTop = mapSize.y;
+		dirtyBottom = 0;
+	}
+private:
+	void draw(sf::RenderTarget& target, sf::RenderStates states) const override
+	{
+		target.draw(quad, states);
+	}
+
+	static constexpr size_t MaxTexelUpdates = 256;
+	sf::Texture texture;
+	std::vector<sf::Uint8> pixels;
+	std::vector<sf::Vector2u> dirty;
+	unsigned int dirtyTop = 0;
+	unsigned int dirtyBottom = 0;
+	sf::Vector2u mapSize;
+	sf::VertexArray quad;
+};
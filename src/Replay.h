@@ -0,0 +1,771 @@
+// Compact recording of a ToInfinity match and seekable playback of it.
+// A replay holds the match settings, periodic keyframes with the full map
+// and ball state, and per tick only what changed in between: tiles that
+// changed owner, balls that left their straight line (bounces, steering
+// and eliminations) and teams the timer eliminated. Seeking restores the nearest keyframe before the tick
+// and replays the deltas from there. The file is a header and segments of a
+// keyframe with the ticks up to the next one, which a recording can append
+// as the match runs.
+
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "Simulation.h"
+
+class Replay
+{
+public:
+	static constexpr const char* RPL_VERSION = "RPL003";
+
+	struct TileEvent
+	{
+		sf::Uint16 x;
+		sf::Uint16 y;
+		sf::Uint8 owner;
+	};
+	struct BallEvent
+	{
+		sf::Uint32 ball;
+		float x;
+		float y;
+		float dx;
+		float dy;
+		sf::Uint8 alive;
+	};
+	struct Elimination
+	{
+		sf::Int32 tick;
+		sf::Uint8 team;
+	};
+	struct Keyframe
+	{
+		sf::Int32 tick = 0;
+		sf::Int64 timer = 0;
+		std::vector<sf::Uint8> map;
+		std::vector<float> x;
+		std::vector<float> y;
+		std::vector<float> dx;
+		std::vector<float> dy;
+		std::vector<sf::Uint8> alive;
+	};
+
+	/// <summary>
+	/// Match state rebuilt during playback.
+	/// </summary>
+	struct State
+	{
+		int tick = 0;
+		BallArrays balls;
+		OwnershipGrid map;
+		OwnedTiles owned;
+		std::vector<int> totalTiles;
+		/// <summary>
+		/// Tick on which each team was eliminated, -1 while it is still playing.
+		/// </summary>
+		std::vector<int> eliminationTick;
+		sf::Time timer;
+	};
+
+	/// <summary>
+	/// Starts a new recording of a match that was just set up.
+	/// </summary>
+	/// <param name="keyframeInterval">Ticks between two full keyframes</param>
+	void Begin(const Simulation& sim, float newTickRate, int newKeyframeInterval = 600)
+	{
+		settings = sim.getSettings();
+		tickRate = newTickRate;
+		keyframeInterval = std::max(1, newKeyframeInterval);
+		tileEvents.clear();
+		ballEvents.clear();
+		keyframes.clear();
+		tileEventEnd.clear();
+		ballEventEnd.clear();
+		eliminations.clear();
+		eliminationTick = sim.getEliminationTicks();
+		AddKeyframe(sim);
+	}
+
+	/// <summary>
+	/// Records a tile that changed owner during the current tick.
+	/// Meant to be called from Simulation::onTileChanged.
+	/// </summary>
+	void RecordTile(const sf::Vector2i& tile, int owner)
+	{
+		tileEvents.push_back(TileEvent{ static_cast<sf::Uint16>(tile.x), static_cast<sf::Uint16>(tile.y), static_cast<sf::Uint8>(owner) });
+	}
+
+	/// <summary>
+	/// Closes the tick that the simulation just finished. Balls are only
+	/// stored when they drift from where playback would put them.
+	/// </summary>
+	void EndTick(const Simulation& sim)
+	{
+		const BallArrays& balls = sim.getBalls();
+		const float step = StepLength();
+		for (size_t i = 0; i < balls.size(); i++)
+		{
+			if (predicted.alive[i])
+				Advance(predicted, i, step);
+			if (balls.alive[i] == predicted.alive[i] && balls.dx[i] == predicted.dx[i] && balls.dy[i] == predicted.dy[i]
+				&& std::abs(balls.x[i] - predicted.x[i]) <= Tolerance && std::abs(balls.y[i] - predicted.y[i]) <= Tolerance)
+				continue;
+			ballEvents.push_back(BallEvent{ static_cast<sf::Uint32>(i), balls.x[i], balls.y[i], balls.dx[i], balls.dy[i], balls.alive[i] });
+			CopyBall(balls, predicted, i);
+		}
+		//a team is eliminated at most once, so new ticks are the teams eliminated during this one
+		const std::vector<int>& ticks = sim.getEliminationTicks();
+		for (size_t team = 0; team < ticks.size(); team++)
+			if (ticks[team] != eliminationTick[team])
+			{
+				eliminations.push_back(Elimination{ static_cast<sf::Int32>(getTickCount()), static_cast<sf::Uint8>(team) });
+				eliminationTick[team] = ticks[team];
+			}
+		tileEventEnd.push_back(static_cast<sf::Uint32>(tileEvents.size()));
+		ballEventEnd.push_back(static_cast<sf::Uint32>(ballEvents.size()));
+		if (getTickCount() % keyframeInterval == 0)
+		{
+			AddKeyframe(sim);
+			WriteSegments(keyframes.size() - 1);
+		}
+	}
+
+	int getTickCount() const
+	{
+		return static_cast<int>(tileEventEnd.size());
+	}
+	size_t getTileEventCount() const
+	{
+		return tileEvents.size();
+	}
+	size_t getBallEventCount() const
+	{
+		return ballEvents.size();
+	}
+	const std::vector<Elimination>& getEliminations() const
+	{
+		return eliminations;
+	}
+	const MatchSettings& getSettings() const
+	{
+		return settings;
+	}
+	float getTickRate() const
+	{
+		return tickRate;
+	}
+
+	/// <summary>
+	/// Rebuilds the state at the tick from the nearest keyframe before it.
+	/// </summary>
+	void Seek(State& state, int tick) const
+	{
+		tick = std::max(0, std::min(tick, getTickCount()));
+		size_t k = 0;
+		while (k + 1 < keyframes.size() && keyframes[k + 1].tick <= tick)
+			k++;
+		const Keyframe& key = keyframes[k];
+		state.tick = key.tick;
+		state.timer = sf::microseconds(key.timer);
+		state.map.create(settings.mapSize);
+		state.owned.create(settings.mapSize, settings.teamCount + 1);
+		state.totalTiles.assign(settings.teamCount, 0);
+		state.eliminationTick.assign(settings.teamCount, -1);
+		for (size_t e = 0; e < eliminations.size() && eliminations[e].tick < key.tick; e++)
+			state.eliminationTick[eliminations[e].team] = eliminations[e].tick;
+		size_t index = 0;
+		for (unsigned int y = 0; y < settings.mapSize.y; y++)
+			for (unsigned int x = 0; x < settings.mapSize.x; x++, index++)
+			{
+				state.map(x, y) = key.map[index];
+				state.owned.set(x, y, 0, key.map[index]);
+				if (key.map[index] > 0)
+					state.totalTiles[key.map[index] - 1]++;
+			}
+		state.balls.resize(key.x.size());
+		state.balls.x = key.x;
+		state.balls.y = key.y;
+		state.balls.dx = key.dx;
+		state.balls.dy = key.dy;
+		state.balls.alive = key.alive;
+		for (size_t i = 0; i < state.balls.size(); i++)
+			state.balls.team[i] = static_cast<sf::Uint8>(i % settings.teamCount);
+		state.balls.prevX = state.balls.x;
+		state.balls.prevY = state.balls.y;
+		while (state.tick < tick)
+			Step(state, [](const sf::Vector2i&, int, int) {});
+	}
+
+	/// <summary>
+	/// Advances the state by one recorded tick. onTile(tile, previous, owner)
+	/// is called for every tile that changes owner. Returns false at the end.
+	/// </summary>
+	template<typename F>
+	bool Step(State& state, F&& onTile) const
+	{
+		if (state.tick >= getTickCount())
+			return false;
+		BallArrays& balls = state.balls;
+		balls.prevX = balls.x;
+		balls.prevY = balls.y;
+		const float step = StepLength();
+		for (size_t i = 0; i < balls.size(); i++)
+			if (balls.alive[i])
+				Advance(balls, i, step);
+
+		for (sf::Uint32 e = BallBegin(state.tick); e < ballEventEnd[state.tick]; e++)
+		{
+			const BallEvent& n = ballEvents[e];
+			balls.x[n.ball] = n.x;
+			balls.y[n.ball] = n.y;
+			balls.dx[n.ball] = n.dx;
+			balls.dy[n.ball] = n.dy;
+			balls.alive[n.ball] = n.alive;
+		}
+		for (sf::Uint32 e = TileBegin(state.tick); e < tileEventEnd[state.tick]; e++)
+		{
+			const TileEvent& n = tileEvents[e];
+			const int previous = state.map(n.x, n.y);
+			if (previous > 0)
+				state.totalTiles[previous - 1]--;
+			if (n.owner > 0)
+				state.totalTiles[n.owner - 1]++;
+			state.map(n.x, n.y) = n.owner;
+			state.owned.set(n.x, n.y, previous, n.owner);
+			onTile(sf::Vector2i(n.x, n.y), previous, n.owner);
+		}
+
+		bool eliminated = false;
+		for (auto n = FirstElimination(state.tick); n != eliminations.end() && n->tick == state.tick; ++n)
+		{
+			state.eliminationTick[n->team] = n->tick;
+			eliminated = true;
+		}
+
+		//same countdown as Simulation::TimerUpdate, which resets it on every elimination
+		if (settings.timerMode)
+		{
+			state.timer -= TickDelta();
+			if (eliminated)
+				state.timer = settings.timerLength;
+			else if (state.timer < sf::Time::Zero)
+				state.timer = sf::Time::Zero;
+		}
+		state.tick++;
+
+		//snap to the keyframe so playing through it gives the same state as seeking to it
+		const size_t k = state.tick / keyframeInterval;
+		if (k < keyframes.size() && keyframes[k].tick == state.tick)
+		{
+			balls.x = keyframes[k].x;
+			balls.y = keyframes[k].y;
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Writes the recording to the file while the match runs. Each segment is
+	/// appended and flushed as soon as the next keyframe closes it, so a crash
+	/// only loses the ticks since the last keyframe. Call after Begin().
+	/// </summary>
+	/// <param name="fileName">File to save the data into</param>
+	bool openFile(const std::filesystem::path& fileName)
+	{
+		file.close();
+		file.clear();
+		file.open(fileName, std::ios::binary);
+		if (!file.is_open())
+			return false;
+		std::string data = "";
+		SaveHeader(data);
+		file << data;
+		file.flush();
+		written = 0;
+		return static_cast<bool>(file);
+	}
+
+	/// <summary>
+	/// Appends the open segment to the file of openFile() and closes it.
+	/// Returns false if any of the recording could not be written.
+	/// </summary>
+	bool closeFile()
+	{
+		if (!file.is_open())
+			return false;
+		WriteSegments(keyframes.size());
+		file.close();
+		return !file.fail();
+	}
+
+	/// <summary>
+	/// Creates a file on the system and saves the replay into it.
+	/// </summary>
+	/// <param name="fileName">File to save the data into</param>
+	bool saveToFile(const std::filesystem::path& fileName) const
+	{
+		std::ofstream save1;
+		save1.open(fileName, std::ios::binary);
+		if (!save1.is_open())
+			return false;
+		std::string data = "";
+		saveToMemory(data);
+		save1 << data;
+		save1.flush();
+		return static_cast<bool>(save1);
+	}
+
+	/// <summary>
+	/// Appends the replay to the string.
+	/// </summary>
+	/// <param name="memory">String of memory to save the data into</param>
+	void saveToMemory(std::string& memory) const
+	{
+		SaveHeader(memory);
+		for (size_t k = 0; k < keyframes.size(); k++)
+			SaveSegment(memory, k);
+	}
+
+	/// <summary>
+	/// Loads a replay from a file.
+	/// </summary>
+	/// <param name="fileName">Path of the replay file to load</param>
+	bool loadFromFile(const std::filesystem::path& fileName)
+	{
+		sf::FileInputStream load1;
+		if (load1.open(fileName.string()))
+			return loadFromStream(load1);
+		return false;
+	}
+
+	/// <summary>
+	/// Loads a replay from a string.
+	/// </summary>
+	bool loadFromMemory(const std::string& data, sf::Uint64 size)
+	{
+		sf::MemoryInputStream stream;
+		stream.open(data.c_str(), size);
+		return loadFromStream(stream);
+	}
+
+	/// <summary>
+	/// This function is used by loadFromFile() as well
+	/// as loadFromMemory() to load replay data. A segment cut short by the
+	/// end of the data, as a crash while recording leaves it, is dropped.
+	/// </summary>
+	/// <param name="stream">Stream to load from</param>
+	bool loadFromStream(sf::InputStream& stream)
+	{
+		std::string ver = "123456";
+		stream.read(&ver[0], 6);
+		if (ver != RPL_VERSION)
+			return false;
+		sf::Uint32 seed;
+		sf::Int32 ballCount, teamCount, interval;
+		sf::Uint8 timerMode;
+		sf::Int64 timerLength;
+		Load(stream, seed);
+		Load(stream, ballCount);
+		Load(stream, teamCount);
+		Load(stream, settings.mapSize.x);
+		Load(stream, settings.mapSize.y);
+		Load(stream, settings.tileLength);
+		Load(stream, settings.ballSpeed);
+		Load(stream, timerMode);
+		Load(stream, timerLength);
+		Load(stream, tickRate);
+		if (!Load(stream, interval) || ballCount < 1 || teamCount < 1 || interval <= 0 || !(tickRate > 0) || !std::isfinite(tickRate))
+			return false;
+		//tile events store their coordinates in 16 bits
+		if (settings.mapSize.x == 0 || settings.mapSize.y == 0 || settings.mapSize.x > MaxMapSide || settings.mapSize.y > MaxMapSide)
+			return false;
+		settings.seed = seed;
+		settings.ballCount = ballCount;
+		settings.teamCount = teamCount;
+		settings.timerMode = timerMode;
+		settings.timerLength = sf::microseconds(timerLength);
+		keyframeInterval = interval;
+
+		keyframes.clear();
+		tileEvents.clear();
+		ballEvents.clear();
+		tileEventEnd.clear();
+		ballEventEnd.clear();
+		eliminations.clear();
+		while (Remaining(stream) > 0)
+		{
+			const SegmentLoad result = LoadSegment(stream);
+			if (result == SegmentLoad::Invalid)
+				return false;
+			if (result == SegmentLoad::Cut)
+				break;
+		}
+		return !keyframes.empty();
+	}
+private:
+	/// <summary>
+	/// How far in pixels a ball may drift from its straight line before it is stored again.
+	/// </summary>
+	static constexpr float Tolerance = 0.01f;
+	static constexpr unsigned int MaxMapSide = 65535;
+	/// <summary>
+	/// Fewest bytes each part of the file can take, to check counts against the stream size.
+	/// </summary>
+	static constexpr sf::Uint64 KeyframeBytes = sizeof(sf::Int32) + sizeof(sf::Int64) + 2;
+	static constexpr sf::Uint64 SegmentTicksBytes = 1;
+	static constexpr sf::Uint64 KeyframeBallBytes = sizeof(float) * 4 + 1;
+	static constexpr sf::Uint64 TickBytes = 2;
+	static constexpr sf::Uint64 TileEventBytes = sizeof(sf::Uint16) * 2 + 1;
+	static constexpr sf::Uint64 BallEventBytes = 1 + sizeof(float) * 4 + 1;
+
+	/// <summary>
+	/// The tick the match ran with, rounded to whole microseconds by sf::Time.
+	/// </summary>
+	sf::Time TickDelta() const
+	{
+		return sf::seconds(1.f / tickRate);
+	}
+	/// <summary>
+	/// How far a ball moves in a tick, computed from the same rounded tick as
+	/// the match so the prediction does not drift away from the balls.
+	/// </summary>
+	float StepLength() const
+	{
+		return TickDelta().asSeconds() * settings.ballSpeed;
+	}
+	static void Advance(BallArrays& balls, size_t i, float step)
+	{
+		balls.x[i] += balls.dx[i] * step;
+		balls.y[i] += balls.dy[i] * step;
+	}
+	sf::Uint32 TileBegin(int tick) const
+	{
+		return tick == 0 ? 0 : tileEventEnd[tick - 1];
+	}
+	sf::Uint32 BallBegin(int tick) const
+	{
+		return tick == 0 ? 0 : ballEventEnd[tick - 1];
+	}
+	/// <summary>
+	/// First elimination on or after the tick.
+	/// </summary>
+	std::vector<Elimination>::const_iterator FirstElimination(int tick) const
+	{
+		return std::lower_bound(eliminations.begin(), eliminations.end(), tick, [](const Elimination& n, int t) { return n.tick < t; });
+	}
+	static void CopyBall(const BallArrays& from, BallArrays& to, size_t i)
+	{
+		to.x[i] = from.x[i];
+		to.y[i] = from.y[i];
+		to.dx[i] = from.dx[i];
+		to.dy[i] = from.dy[i];
+		to.alive[i] = from.alive[i];
+	}
+	void AddKeyframe(const Simulation& sim)
+	{
+		const BallArrays& balls = sim.getBalls();
+		const OwnershipGrid& map = sim.getMap();
+		Keyframe key;
+		key.tick = getTickCount();
+		key.timer = sim.getTimer().asMicroseconds();
+		key.map.reserve(static_cast<size_t>(settings.mapSize.x) * settings.mapSize.y);
+		for (unsigned int y = 0; y < settings.mapSize.y; y++)
+			for (unsigned int x = 0; x < settings.mapSize.x; x++)
+				key.map.push_back(map(x, y));
+		key.x = balls.x;
+		key.y = balls.y;
+		key.dx = balls.dx;
+		key.dy = balls.dy;
+		key.alive = balls.alive;
+		keyframes.push_back(key);
+		//playback restarts from the keyframe, so the prediction does as well
+		predicted = balls;
+	}
+
+	void SaveHeader(std::string& memory) const
+	{
+		memory += RPL_VERSION;
+		Save(memory, static_cast<sf::Uint32>(settings.seed));
+		Save(memory, static_cast<sf::Int32>(settings.ballCount));
+		Save(memory, static_cast<sf::Int32>(settings.teamCount));
+		Save(memory, settings.mapSize.x);
+		Save(memory, settings.mapSize.y);
+		Save(memory, settings.tileLength);
+		Save(memory, settings.ballSpeed);
+		Save(memory, static_cast<sf::Uint8>(settings.timerMode));
+		Save(memory, settings.timerLength.asMicroseconds());
+		Save(memory, tickRate);
+		Save(memory, static_cast<sf::Int32>(keyframeInterval));
+	}
+	/// <summary>
+	/// Saves the keyframe and the recorded ticks up to the next one.
+	/// </summary>
+	void SaveSegment(std::string& memory, size_t k) const
+	{
+		//the map is run-length encoded since owners come in large patches
+		const Keyframe& key = keyframes[k];
+		Save(memory, key.tick);
+		Save(memory, key.timer);
+		for (size_t i = 0; i < key.map.size();)
+		{
+			size_t run = 1;
+			while (i + run < key.map.size() && key.map[i + run] == key.map[i])
+				run++;
+			Save(memory, key.map[i]);
+			SaveVarInt(memory, run);
+			i += run;
+		}
+		for (size_t i = 0; i < key.x.size(); i++)
+		{
+			Save(memory, key.x[i]);
+			Save(memory, key.y[i]);
+			Save(memory, key.dx[i]);
+			Save(memory, key.dy[i]);
+			Save(memory, key.alive[i]);
+		}
+
+		//per tick event counts, most ticks have none so they take two bytes
+		const int end = std::min(key.tick + keyframeInterval, getTickCount());
+		SaveVarInt(memory, end - key.tick);
+		for (int t = key.tick; t < end; t++)
+		{
+			SaveVarInt(memory, tileEventEnd[t] - TileBegin(t));
+			SaveVarInt(memory, ballEventEnd[t] - BallBegin(t));
+		}
+		for (sf::Uint32 e = TileBegin(key.tick); e < TileBegin(end); e++)
+		{
+			const TileEvent& n = tileEvents[e];
+			Save(memory, n.x);
+			Save(memory, n.y);
+			Save(memory, n.owner);
+		}
+		for (sf::Uint32 e = BallBegin(key.tick); e < BallBegin(end); e++)
+		{
+			const BallEvent& n = ballEvents[e];
+			SaveVarInt(memory, n.ball);
+			Save(memory, n.x);
+			Save(memory, n.y);
+			Save(memory, n.dx);
+			Save(memory, n.dy);
+			Save(memory, n.alive);
+		}
+		const auto first = FirstElimination(key.tick);
+		const auto last = FirstElimination(end);
+		SaveVarInt(memory, last - first);
+		for (auto n = first; n != last; ++n)
+		{
+			SaveVarInt(memory, n->tick - key.tick);
+			Save(memory, n->team);
+		}
+	}
+	/// <summary>
+	/// Appends the segments before the end to the file of openFile(), if there is one.
+	/// </summary>
+	void WriteSegments(size_t end)
+	{
+		if (!file.is_open() || written >= end)
+			return;
+		std::string data = "";
+		for (; written < end; written++)
+			SaveSegment(data, written);
+		file << data;
+		file.flush();
+	}
+
+	enum class SegmentLoad
+	{
+		Loaded,
+		Cut,
+		Invalid
+	};
+	/// <summary>
+	/// Loads the next segment. One that runs past the end of the stream is
+	/// Cut and leaves the replay as it was, one with values no recording
+	/// makes is Invalid.
+	/// </summary>
+	SegmentLoad LoadSegment(sf::InputStream& stream)
+	{
+		const int ballCount = settings.ballCount;
+		const int begin = getTickCount();
+		const size_t tileStart = tileEvents.size();
+		const size_t ballStart = ballEvents.size();
+		const size_t eliminationStart = eliminations.size();
+		auto cut = [&]()
+			{
+				tileEventEnd.resize(begin);
+				ballEventEnd.resize(begin);
+				tileEvents.resize(tileStart);
+				ballEvents.resize(ballStart);
+				eliminations.resize(eliminationStart);
+				return SegmentLoad::Cut;
+			};
+
+		//segments follow each other without gaps, so only the last one may be short
+		Keyframe key;
+		if (!Load(stream, key.tick) || !Load(stream, key.timer))
+			return cut();
+		if (key.tick != begin || static_cast<sf::Int64>(keyframes.size()) * keyframeInterval != begin)
+			return SegmentLoad::Invalid;
+		if (KeyframeBytes + static_cast<sf::Uint64>(ballCount) * KeyframeBallBytes + SegmentTicksBytes > Remaining(stream))
+			return cut();
+		const size_t tiles = static_cast<size_t>(settings.mapSize.x) * settings.mapSize.y;
+		while (key.map.size() < tiles)
+		{
+			sf::Uint8 owner;
+			sf::Uint64 run;
+			if (!Load(stream, owner) || !LoadVarInt(stream, run))
+				return cut();
+			if (run == 0 || owner > settings.teamCount || key.map.size() + run > tiles)
+				return SegmentLoad::Invalid;
+			key.map.insert(key.map.end(), run, owner);
+		}
+		key.x.resize(ballCount);
+		key.y.resize(ballCount);
+		key.dx.resize(ballCount);
+		key.dy.resize(ballCount);
+		key.alive.resize(ballCount);
+		for (int i = 0; i < ballCount; i++)
+		{
+			Load(stream, key.x[i]);
+			Load(stream, key.y[i]);
+			Load(stream, key.dx[i]);
+			Load(stream, key.dy[i]);
+			if (!Load(stream, key.alive[i]))
+				return cut();
+		}
+
+		//every count has to fit in what is left of the stream before anything is allocated for it
+		sf::Uint64 ticks;
+		if (!LoadVarInt(stream, ticks))
+			return cut();
+		if (ticks > static_cast<sf::Uint64>(keyframeInterval))
+			return SegmentLoad::Invalid;
+		if (ticks * TickBytes > Remaining(stream))
+			return cut();
+		sf::Uint64 tile = tileStart;
+		sf::Uint64 ball = ballStart;
+		for (sf::Uint64 t = 0; t < ticks; t++)
+		{
+			sf::Uint64 tileChanges, ballChanges;
+			if (!LoadVarInt(stream, tileChanges) || !LoadVarInt(stream, ballChanges) || tileChanges > Remaining(stream) || ballChanges > Remaining(stream))
+				return cut();
+			tile += tileChanges;
+			ball += ballChanges;
+			if ((tile - tileStart) * TileEventBytes + (ball - ballStart) * BallEventBytes > Remaining(stream))
+				return cut();
+			if (tile > std::numeric_limits<sf::Uint32>::max() || ball > std::numeric_limits<sf::Uint32>::max())
+				return SegmentLoad::Invalid;
+			tileEventEnd.push_back(static_cast<sf::Uint32>(tile));
+			ballEventEnd.push_back(static_cast<sf::Uint32>(ball));
+		}
+		tileEvents.resize(tile);
+		for (size_t e = tileStart; e < tileEvents.size(); e++)
+		{
+			TileEvent& n = tileEvents[e];
+			Load(stream, n.x);
+			Load(stream, n.y);
+			if (!Load(stream, n.owner))
+				return cut();
+			if (n.owner > settings.teamCount || n.x >= settings.mapSize.x || n.y >= settings.mapSize.y)
+				return SegmentLoad::Invalid;
+		}
+		ballEvents.resize(ball);
+		for (size_t e = ballStart; e < ballEvents.size(); e++)
+		{
+			BallEvent& n = ballEvents[e];
+			sf::Uint64 index;
+			if (!LoadVarInt(stream, index))
+				return cut();
+			if (index >= static_cast<sf::Uint64>(ballCount))
+				return SegmentLoad::Invalid;
+			n.ball = static_cast<sf::Uint32>(index);
+			Load(stream, n.x);
+			Load(stream, n.y);
+			Load(stream, n.dx);
+			Load(stream, n.dy);
+			if (!Load(stream, n.alive))
+				return cut();
+		}
+		//eliminations in tick order, each team at most once
+		sf::Uint64 eliminationCount;
+		if (!LoadVarInt(stream, eliminationCount))
+			return cut();
+		if (eliminationCount > static_cast<sf::Uint64>(settings.teamCount))
+			return SegmentLoad::Invalid;
+		for (sf::Uint64 e = 0; e < eliminationCount; e++)
+		{
+			sf::Uint64 offset;
+			Elimination n;
+			if (!LoadVarInt(stream, offset) || !Load(stream, n.team))
+				return cut();
+			if (offset >= ticks || n.team >= settings.teamCount)
+				return SegmentLoad::Invalid;
+			n.tick = begin + static_cast<sf::Int32>(offset);
+			for (const Elimination& previous : eliminations)
+				if (previous.team == n.team || previous.tick > n.tick)
+					return SegmentLoad::Invalid;
+			eliminations.push_back(n);
+		}
+		keyframes.push_back(std::move(key));
+		return SegmentLoad::Loaded;
+	}
+
+	template<typename T>
+	static void Save(std::string& s, T var)
+	{
+		for (size_t i = 0; i < sizeof(T); i++)
+			s += (reinterpret_cast<char*>(&var))[i];
+	}
+	static void SaveVarInt(std::string& s, sf::Uint64 var)
+	{
+		while (var >= 0x80)
+		{
+			s += static_cast<char>((var & 0x7F) | 0x80);
+			var >>= 7;
+		}
+		s += static_cast<char>(var);
+	}
+	template<typename T>
+	static bool Load(sf::InputStream& input, T& t)
+	{
+		return input.read(&t, sizeof(T)) == sizeof(T);
+	}
+	static sf::Uint64 Remaining(sf::InputStream& input)
+	{
+		const sf::Int64 size = input.getSize();
+		const sf::Int64 position = input.tell();
+		return size < 0 || position < 0 || position > size ? 0 : static_cast<sf::Uint64>(size - position);
+	}
+	static bool LoadVarInt(sf::InputStream& input, sf::Uint64& var)
+	{
+		var = 0;
+		for (int shift = 0; shift < 64; shift += 7)
+		{
+			sf::Uint8 byte;
+			if (!Load(input, byte))
+				return false;
+			var |= static_cast<sf::Uint64>(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				return true;
+		}
+		return false;
+	}
+
+	MatchSettings settings;
+	float tickRate = 120.f;
+	int keyframeInterval = 600;
+	std::vector<Keyframe> keyframes;
+	std::vector<TileEvent> tileEvents;
+	std::vector<BallEvent> ballEvents;
+	std::vector<sf::Uint32> tileEventEnd;
+	std::vector<sf::Uint32> ballEventEnd;
+	std::vector<Elimination> eliminations;
+	std::vector<int> eliminationTick;
+	BallArrays predicted;
+	std::ofstream file;
+	size_t written = 0;
+};
@@ -0,0 +1,707 @@
+// The ToInfinity match without any window or rendering. Every instance is
+// self-contained, so several matches can run side by side on different
+// threads. Renderers follow the match through the onTileChanged hook.
+
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <queue>
+#include <cmath>
+#include "ZLE.h"
+#include "OwnershipGrid.h"
+#include "BallKernel.h"
+#include "BallContacts.h"
+#include "WorkerPool.h"
+
+class TeamRanking
+{
+	std::vector<int> order;
+	std::vector<int> position;
+	void Swap(int a, int b)
+	{
+		std::swap(order[a], order[b]);
+		position[order[a]] = a;
+		position[order[b]] = b;
+	}
+public:
+	void Reset(int teams)
+	{
+		order.resize(teams);
+		position.resize(teams);
+		for (int i = 0; i < teams; i++)
+			order[i] = position[i] = i;
+	}
+	/// <summary>
+	/// Puts back an order taken with Order(), teams missing from it are out.
+	/// </summary>
+	void Restore(int teams, const std::vector<int>& newOrder)
+	{
+		order = newOrder;
+		position.assign(teams, -1);
+		for (int i = 0; i < static_cast<int>(order.size()); i++)
+			position[order[i]] = i;
+	}
+	/// <summary>
+	/// Moves the team to its new place after its count changed, ties keep their order.
+	/// </summary>
+	void Changed(int team, const std::vector<int>& totals)
+	{
+		int p = position[team];
+		while (p > 0 && totals[order[p - 1]] < totals[team])
+			Swap(p, p - 1), p--;
+		while (p + 1 < static_cast<int>(order.size()) && totals[order[p + 1]] > totals[team])
+			Swap(p, p + 1), p++;
+	}
+	void Remove(int team)
+	{
+		order.erase(order.begin() + position[team]);
+		for (int i = position[team]; i < static_cast<int>(order.size()); i++)
+			position[order[i]] = i;
+		position[team] = -1;
+	}
+	int Leader() const
+	{
+		return order.front();
+	}
+	int Trailer() const
+	{
+		return order.back();
+	}
+	int TeamsLeft() const
+	{
+		return static_cast<int>(order.size());
+	}
+	bool Contains(int team) const
+	{
+		return position[team] >= 0;
+	}
+	/// <summary>
+	/// Teams still playing, the leader first.
+	/// </summary>
+	const std::vector<int>& Order() const
+	{
+		return order;
+	}
+};
+
+/// <summary>
+/// Every user of randomness draws from its own stream of the match seed,
+/// indexed per ball or per emitter where there are several.
+/// </summary>
+enum class RandomStream : sf::Uint32
+{
+	BallSetup,
+	TileBreak,
+	SnowFall,
+	WallBreakEmitter,
+	BallTrailEmitter,
+	SnowEmitter,
+	Rollout
+};
+
+inline uint64_t StreamID(RandomStream stream, sf::Uint32 index = 0)
+{
+	return static_cast<uint64_t>(stream) << 32 | index;
+}
+
+struct MatchSettings
+{
+	unsigned int seed = 0;
+	int ballCount = 4;
+	int teamCount = 4;
+	sf::Vector2u mapSize = sf::Vector2u(16, 9) * 2U;
+	float tileLength = 60.f;
+	float ballSpeed = 800.f;
+	/// <summary>
+	/// With the timer on, the last team is eliminated every timerLength.
+	/// </summary>
+	bool timerMode = false;
+	sf::Time timerLength = sf::seconds(60);
+	/// <summary>
+	/// Balls bounce off each other instead of passing through.
+	/// </summary>
+	bool ballCollisions = false;
+};
+/// <summary>
+/// The state of a match in plain arrays, enough for another Simulation to
+/// carry on from it. Taking one only copies arrays, and a snapshot that is
+/// reused keeps its memory.
+/// </summary>
+struct MatchSnapshot
+{
+	sf::Uint32 seed = 0;
+	int ballCount = 0;
+	int teamCount = 0;
+	sf::Uint32 mapWidth = 0;
+	sf::Uint32 mapHeight = 0;
+	float tileLength = 0;
+	float ballSpeed = 0;
+	bool timerMode = false;
+	/// <summary>
+	/// Microseconds per elimination.
+	/// </summary>
+	sf::Int64 timerLength = 0;
+	bool ballCollisions = false;
+	int tickCount = 0;
+	/// <summary>
+	/// Microseconds left on the timer.
+	/// </summary>
+	sf::Int64 timer = 0;
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> dx;
+	std::vector<float> dy;
+	std::vector<sf::Uint8> team;
+	std::vector<sf::Uint8> alive;
+	/// <summary>
+	/// Owners in the storage order of the map.
+	/// </summary>
+	std::vector<sf::Uint8> tiles;
+	std::vector<int> ranking;
+	std::vector<int> eliminationTick;
+};
+
+class Simulation
+{
+public:
+	/// <summary>
+	/// Called whenever a tile changes owner, owners are team + 1 and 0 for
+	/// nobody. A ball capture passes the owner it took the tile from.
+	/// </summary>
+	std::function<void(const sf::Vector2i& tile, int previous, int owner)> onTileChanged;
+
+	/// <summary>
+	/// Resets the match. Balls are spread round-robin over the teams and
+	/// start around the four quarter points of the canvas.
+	/// </summary>
+	void Setup(const MatchSettings& newSettings)
+	{
+		settings = newSettings;
+		settings.teamCount = std::max(1, std::min(settings.teamCount, 255));
+		settings.ballCount = std::max(1, settings.ballCount);
+		//replays store tile coordinates in 16 bits
+		settings.mapSize.x = std::max(1u, std::min(settings.mapSize.x, 65535u));
+		settings.mapSize.y = std::max(1u, std::min(settings.mapSize.y, 65535u));
+		Resize();
+		const std::vector<sf::Vector2f> ballPos = { sf::Vector2f(canvasSize.x / 4, canvasSize.y / 4), sf::Vector2f(canvasSize.x / 4 * 3, canvasSize.y / 4),
+			sf::Vector2f(canvasSize.x / 4, canvasSize.y / 4 * 3), sf::Vector2f(canvasSize.x / 4 * 3, canvasSize.y / 4 * 3) };
+		balls.resize(settings.ballCount);
+		for (size_t i = 0; i < balls.size(); i++)
+		{
+			balls.team[i] = static_cast<sf::Uint8>(i % settings.teamCount);
+			balls.alive[i] = true;
+			//a stream per ball, so adding balls does not move the ones before them
+			zle::Random random(settings.seed, StreamID(RandomStream::BallSetup, static_cast<sf::Uint32>(i)));
+			const float dirX = 1 + random.nextInt(2) * -2.f;
+			const float dirY = 1 + random.nextInt(2) * -2.f;
+			const float offsetX = (random.nextFloat() * 2 - 1) * canvasSize.x / 10.f;
+			const float offsetY = (random.nextFloat() * 2 - 1) * canvasSize.y / 10.f;
+			const sf::Vector2f start = ballPos[balls.team[i] % ballPos.size()] + sf::Vector2f(offsetX, offsetY);
+			balls.dx[i] = dirX;
+			balls.dy[i] = dirY;
+			balls.x[i] = start.x;
+			balls.y[i] = start.y;
+			balls.prevX[i] = balls.x[i];
+			balls.prevY[i] = balls.y[i];
+		}
+		map.create(settings.mapSize);
+		owned.create(settings.mapSize, settings.teamCount + 1);
+		totalTiles.assign(settings.teamCount, 0);
+		eliminationTick.assign(settings.teamCount, -1);
+		ranking.Reset(settings.teamCount);
+		timer = settings.timerLength;
+		tickCount = 0;
+		ResetSchedule();
+	}
+
+	/// <summary>
+	/// Copies the match into snapshot. The schedule of the event driven mode
+	/// is left out, it is rebuilt from the balls.
+	/// </summary>
+	void saveSnapshot(MatchSnapshot& snapshot) const
+	{
+		snapshot.seed = settings.seed;
+		snapshot.ballCount = settings.ballCount;
+		snapshot.teamCount = settings.teamCount;
+		snapshot.mapWidth = settings.mapSize.x;
+		snapshot.mapHeight = settings.mapSize.y;
+		snapshot.tileLength = settings.tileLength;
+		snapshot.ballSpeed = settings.ballSpeed;
+		snapshot.timerMode = settings.timerMode;
+		snapshot.timerLength = settings.timerLength.asMicroseconds();
+		snapshot.ballCollisions = settings.ballCollisions;
+		snapshot.tickCount = tickCount;
+		snapshot.timer = timer.asMicroseconds();
+		snapshot.x = balls.x;
+		snapshot.y = balls.y;
+		snapshot.dx = balls.dx;
+		snapshot.dy = balls.dy;
+		snapshot.team = balls.team;
+		snapshot.alive = balls.alive;
+		snapshot.tiles = map.getStorage();
+		snapshot.ranking = ranking.Order();
+		snapshot.eliminationTick = eliminationTick;
+	}
+	/// <summary>
+	/// Carries on from a snapshot, the match plays out as the one it was
+	/// taken from. onTileChanged is not called for the restored tiles.
+	/// </summary>
+	void loadSnapshot(const MatchSnapshot& snapshot)
+	{
+		settings.seed = snapshot.seed;
+		settings.ballCount = snapshot.ballCount;
+		settings.teamCount = snapshot.teamCount;
+		settings.mapSize = sf::Vector2u(snapshot.mapWidth, snapshot.mapHeight);
+		settings.tileLength = snapshot.tileLength;
+		settings.ballSpeed = snapshot.ballSpeed;
+		settings.timerMode = snapshot.timerMode;
+		settings.timerLength = sf::microseconds(snapshot.timerLength);
+		settings.ballCollisions = snapshot.ballCollisions;
+		Resize();
+		balls.x = snapshot.x;
+		balls.y = snapshot.y;
+		balls.dx = snapshot.dx;
+		balls.dy = snapshot.dy;
+		balls.team = snapshot.team;
+		balls.alive = snapshot.alive;
+		balls.prevX = balls.x;
+		balls.prevY = balls.y;
+		map.create(settings.mapSize);
+		map.setStorage(snapshot.tiles);
+		owned.create(settings.mapSize, settings.teamCount + 1);
+		for (unsigned int y = 0; y < settings.mapSize.y; y++)
+			for (unsigned int x = 0; x < settings.mapSize.x; x++)
+				if (map(x, y) > 0)
+					owned.set(x, y, 0, map(x, y));
+		totalTiles.resize(settings.teamCount);
+		for (int i = 0; i < settings.teamCount; i++)
+			totalTiles[i] = static_cast<int>(owned.count(i + 1));
+		eliminationTick = snapshot.eliminationTick;
+		ranking.Restore(settings.teamCount, snapshot.ranking);
+		timer = sf::microseconds(snapshot.timer);
+		tickCount = snapshot.tickCount;
+		ResetSchedule();
+	}
+
+	/// <summary>
+	/// Lets the ball sweep run on the pool, nullptr keeps it on the calling thread.
+	/// </summary>
+	void setWorkers(WorkerPool* pool)
+	{
+		workers = pool;
+	}
+
+	/// <summary>
+	/// Event driven collisions only test the balls that are due. Every ball
+	/// gets the number of ticks until it can next touch an enemy tile or a
+	/// wall and sleeps in a queue until then, a capture wakes the sleeping
+	/// balls of the team that lost the tile early. The other balls only move,
+	/// so the match plays out exactly as with testing every ball. This mode
+	/// runs on the calling thread.
+	/// </summary>
+	void setEventDriven(bool enabled)
+	{
+		eventDriven = enabled;
+		ResetSchedule();
+	}
+	bool isEventDriven() const
+	{
+		return eventDriven;
+	}
+
+	/// <summary>
+	/// Points a ball in a new direction, use this rather than writing to the
+	/// balls so a sleeping ball is tested again.
+	/// </summary>
+	void Steer(int ball, const sf::Vector2f& direction)
+	{
+		balls.dx[ball] = direction.x;
+		balls.dy[ball] = direction.y;
+		if (eventDriven && !checking[ball])
+		{
+			Wake(ball);
+			MergeWoken();
+		}
+	}
+
+	void Tick(const sf::Time& delta)
+	{
+		balls.prevX = balls.x;
+		balls.prevY = balls.y;
+		if (settings.timerMode)
+			TimerUpdate(delta);
+		if (eventDriven)
+			WakeDue();
+		SweepAxis(true, delta);
+		SweepAxis(false, delta);
+		if (settings.ballCollisions)
+			BallCollisions();
+		tickCount++;
+		if (eventDriven)
+			Reschedule(delta);
+	}
+
+	/// <summary>
+	/// A match is over once a single team is left.
+	/// </summary>
+	bool isFinished() const
+	{
+		return ranking.TeamsLeft() <= 1;
+	}
+
+	const MatchSettings& getSettings() const
+	{
+		return settings;
+	}
+	const BallArrays& getBalls() const
+	{
+		return balls;
+	}
+	const OwnershipGrid& getMap() const
+	{
+		return map;
+	}
+	/// <summary>
+	/// Tiles held by each owner, owners are team + 1.
+	/// </summary>
+	const OwnedTiles& getOwnedTiles() const
+	{
+		return owned;
+	}
+	const std::vector<int>& getTotalTiles() const
+	{
+		return totalTiles;
+	}
+	const TeamRanking& getRanking() const
+	{
+		return ranking;
+	}
+	/// <summary>
+	/// Tick on which each team was eliminated, -1 while it is still playing.
+	/// </summary>
+	const std::vector<int>& getEliminationTicks() const
+	{
+		return eliminationTick;
+	}
+	int getTickCount() const
+	{
+		return tickCount;
+	}
+	sf::Time getTimer() const
+	{
+		return timer;
+	}
+	const sf::Vector2u& getCanvasSize() const
+	{
+		return canvasSize;
+	}
+	sf::Vector2f getTileSize() const
+	{
+		return sf::Vector2f(settings.tileLength, settings.tileLength);
+	}
+	float getBallRadius() const
+	{
+		return ballRadius;
+	}
+private:
+	struct Wakeup
+	{
+		int tick;
+		int ball;
+		sf::Uint32 generation;
+		bool operator>(const Wakeup& other) const
+		{
+			return tick > other.tick;
+		}
+	};
+	struct Sleeper
+	{
+		int ball;
+		sf::Uint32 generation;
+		sf::IntRect area;
+	};
+
+	void Resize()
+	{
+		//tiles keep their size, a bigger map makes a bigger canvas
+		canvasSize = sf::Vector2u(static_cast<unsigned int>(settings.mapSize.x * settings.tileLength), static_cast<unsigned int>(settings.mapSize.y * settings.tileLength));
+		ballRadius = settings.tileLength / 4;
+	}
+	void SetOwner(const sf::Vector2i& tile, int owner)
+	{
+		const int previous = map(tile.x, tile.y);
+		map(tile.x, tile.y) = static_cast<sf::Uint8>(owner);
+		owned.set(tile.x, tile.y, previous, owner);
+		if (eventDriven && previous > 0)
+			WakeNear(tile, previous - 1);
+		if (onTileChanged)
+			onTileChanged(tile, previous, owner);
+	}
+	void Capture(int team, const sf::Vector2i& tile)
+	{
+		const int previous = map(tile.x, tile.y);
+		if (previous > 0)
+		{
+			totalTiles[previous - 1]--;
+			ranking.Changed(previous - 1, totalTiles);
+		}
+		totalTiles[team]++;
+		ranking.Changed(team, totalTiles);
+		SetOwner(tile, team + 1);
+	}
+	void SweepAxis(bool horizontal, const sf::Time& delta)
+	{
+		//sub-step so a single step never exceeds the ball radius and no tile can be skipped,
+		//within a sub-step every ball sees the same map and captures are applied in ball order
+		float fastest = 0;
+		const std::vector<float>& dirs = horizontal ? balls.dx : balls.dy;
+		for (size_t i = 0; i < balls.size(); i++)
+			if (balls.alive[i])
+				fastest = std::max(fastest, std::abs(dirs[i] * delta.asSeconds() * settings.ballSpeed));
+		SweepParams params;
+		params.tileSize = sf::Vector2f(static_cast<float>(canvasSize.x) / settings.mapSize.x, static_cast<float>(canvasSize.y) / settings.mapSize.y);
+		params.canvasSize = sf::Vector2f(canvasSize);
+		params.radius = ballRadius;
+		params.delta = delta.asSeconds();
+		params.speed = settings.ballSpeed;
+		params.steps = std::max(1, static_cast<int>(std::ceil(fastest / ballRadius)));
+		for (int s = 0; s < params.steps; s++)
+		{
+			if (eventDriven)
+				SweepAwake(horizontal, params);
+			else
+				SweepRanges(horizontal, params);
+			for (auto& n : hits)
+			{
+				//conflicts resolve lowest ball first, a later ball hitting a tile taken in the same sub-step only bounces
+				if (map(n.tileX, n.tileY) != n.owner)
+					continue;
+				Capture(balls.team[n.ball], sf::Vector2i(n.tileX, n.tileY));
+			}
+			//balls woken by the captures are tested from the next sub-step on, like every ball is when polling
+			if (eventDriven)
+				MergeWoken();
+		}
+	}
+	/// <summary>
+	/// Sleeping balls move without any test, the awake ones go through the
+	/// usual kernel in ball order so the hits keep the polling order.
+	/// </summary>
+	void SweepAwake(bool horizontal, const SweepParams& params)
+	{
+		float* pos = horizontal ? balls.x.data() : balls.y.data();
+		const float* dir = horizontal ? balls.dx.data() : balls.dy.data();
+		const int count = static_cast<int>(balls.size());
+		for (int i = 0; i < count; i++)
+			if (balls.alive[i] && !checking[i])
+				pos[i] += dir[i] * params.delta * params.speed / params.steps;
+		hits.clear();
+		for (int i : awake)
+			if (balls.alive[i])
+				SweepBall(balls, i, horizontal, params, map, hits);
+	}
+	void ResetSchedule()
+	{
+		schedule = decltype(schedule)();
+		checking.assign(balls.size(), true);
+		generation.assign(balls.size(), 0);
+		awake.clear();
+		woken.clear();
+		for (int i = 0; i < static_cast<int>(balls.size()); i++)
+			awake.push_back(i);
+		bucketCount = sf::Vector2u((settings.mapSize.x + BucketTiles - 1) / BucketTiles, (settings.mapSize.y + BucketTiles - 1) / BucketTiles);
+		buckets.clear();
+		if (eventDriven)
+			buckets.resize(static_cast<size_t>(bucketCount.x) * bucketCount.y);
+	}
+	void Wake(int ball)
+	{
+		checking[ball] = true;
+		generation[ball]++;
+		woken.push_back(ball);
+	}
+	void MergeWoken()
+	{
+		if (woken.empty())
+			return;
+		std::sort(woken.begin(), woken.end());
+		merged.clear();
+		std::merge(awake.begin(), awake.end(), woken.begin(), woken.end(), std::back_inserter(merged));
+		awake.swap(merged);
+		woken.clear();
+	}
+	void WakeDue()
+	{
+		while (!schedule.empty() && schedule.top().tick <= tickCount)
+		{
+			const Wakeup wakeup = schedule.top();
+			schedule.pop();
+			if (wakeup.generation == generation[wakeup.ball] && !checking[wakeup.ball] && balls.alive[wakeup.ball])
+				Wake(wakeup.ball);
+		}
+		MergeWoken();
+	}
+	/// <summary>
+	/// The tile became an enemy of team, every sleeping ball of it whose
+	/// path could reach the tile has to be tested again.
+	/// </summary>
+	void WakeNear(const sf::Vector2i& tile, int team)
+	{
+		std::vector<Sleeper>& bucket = buckets[tile.x / BucketTiles + tile.y / BucketTiles * bucketCount.x];
+		for (size_t i = 0; i < bucket.size();)
+		{
+			const Sleeper& n = bucket[i];
+			if (n.generation == generation[n.ball] && balls.team[n.ball] == team && n.area.contains(tile))
+				Wake(n.ball);
+			if (n.generation != generation[n.ball])
+			{
+				bucket[i] = bucket.back();
+				bucket.pop_back();
+			}
+			else
+				i++;
+		}
+	}
+	/// <summary>
+	/// Puts the awake balls that are clear of any contact to sleep.
+	/// </summary>
+	void Reschedule(const sf::Time& delta)
+	{
+		SweepParams params;
+		params.tileSize = sf::Vector2f(static_cast<float>(canvasSize.x) / settings.mapSize.x, static_cast<float>(canvasSize.y) / settings.mapSize.y);
+		params.canvasSize = sf::Vector2f(canvasSize);
+		params.radius = ballRadius;
+		params.delta = delta.asSeconds();
+		params.speed = settings.ballSpeed;
+		params.steps = 1;
+		merged.clear();
+		for (int i : awake)
+		{
+			if (!balls.alive[i])
+				continue;
+			//the horizon is kept to a few tiles so the area to wake from stays small
+			const float perTick = std::max(std::abs(balls.dx[i]), std::abs(balls.dy[i])) * params.delta * params.speed;
+			const int horizon = perTick > 0 ? std::max(1, std::min(MaxSleepTicks, static_cast<int>(SleepTiles * params.tileSize.x / perTick))) : MaxSleepTicks;
+			sf::IntRect area;
+			const int ticks = PredictContact(balls, i, params, map, horizon, area);
+			if (ticks == 0)
+			{
+				merged.push_back(i);
+				continue;
+			}
+			checking[i] = false;
+			generation[i]++;
+			schedule.push(Wakeup{ tickCount + ticks, i, generation[i] });
+			const int bx0 = area.left / BucketTiles;
+			const int by0 = area.top / BucketTiles;
+			const int bx1 = (area.left + area.width - 1) / BucketTiles;
+			const int by1 = (area.top + area.height - 1) / BucketTiles;
+			for (int by = by0; by <= by1; by++)
+				for (int bx = bx0; bx <= bx1; bx++)
+					Register(buckets[bx + by * bucketCount.x], Sleeper{ i, generation[i], area });
+		}
+		awake.swap(merged);
+	}
+	void Register(std::vector<Sleeper>& bucket, const Sleeper& sleeper)
+	{
+		//buckets without captures are never swept, so drop the stale entries before they grow
+		if (bucket.size() >= 16 && bucket.size() == bucket.capacity())
+			bucket.erase(std::remove_if(bucket.begin(), bucket.end(), [this](const Sleeper& n) { return n.generation != generation[n.ball]; }), bucket.end());
+		bucket.push_back(sleeper);
+	}
+	/// <summary>
+	/// Splits the balls over the worker threads. Every range reads the same
+	/// map and the per-thread hits are joined in range order, so they match
+	/// the serial order.
+	/// </summary>
+	void SweepRanges(bool horizontal, const SweepParams& params)
+	{
+		const int count = static_cast<int>(balls.size());
+		const int tasks = workers ? std::min(static_cast<int>(workers->getThreadCount()), count / MinBallsPerTask) : 1;
+		hits.clear();
+		if (tasks <= 1)
+		{
+			SweepBalls(balls, 0, count, horizontal, params, map, hits);
+			return;
+		}
+		//ranges start on cache line boundaries so threads never write the same line
+		const int align = 64 / sizeof(float);
+		const int chunk = ((count + tasks - 1) / tasks + align - 1) / align * align;
+		threadHits.resize(tasks);
+		workers->run(tasks, [&](int t)
+			{
+				threadHits[t].clear();
+				SweepBalls(balls, std::min(t * chunk, count), std::min((t + 1) * chunk, count), horizontal, params, map, threadHits[t]);
+			});
+		for (auto& n : threadHits)
+			hits.insert(hits.end(), n.begin(), n.end());
+	}
+	/// <summary>
+	/// A contact changes where a ball goes, so a sleeping ball that took part
+	/// is woken to have its next contact predicted again.
+	/// </summary>
+	void BallCollisions()
+	{
+		contacts.resolve(balls, ballRadius, getTileSize(), settings.mapSize, [this](int ball)
+			{
+				if (eventDriven && !checking[ball])
+					Wake(ball);
+			});
+		if (eventDriven)
+			MergeWoken();
+	}
+	void TimerUpdate(const sf::Time& delta)
+	{
+		timer -= delta;
+		if (timer >= sf::Time::Zero)
+			return;
+		if (ranking.TeamsLeft() <= 1)
+		{
+			timer = sf::Time::Zero;
+			return;
+		}
+		const int lowest = ranking.Trailer();
+		for (size_t i = 0; i < balls.size(); i++)
+			if (balls.team[i] == lowest)
+				balls.alive[i] = false;
+		//every release takes the tile off the back of the list
+		const std::vector<sf::Uint32>& lost = owned.tiles(lowest + 1);
+		while (!lost.empty())
+			SetOwner(owned.position(lost.back()), 0);
+		totalTiles[lowest] = 0;
+		ranking.Remove(lowest);
+		eliminationTick[lowest] = tickCount;
+		timer = settings.timerLength;
+	}
+
+	static constexpr int MinBallsPerTask = 2048;
+	static constexpr int MaxSleepTicks = 64;
+	static constexpr float SleepTiles = 4;
+	static constexpr unsigned int BucketTiles = 4;
+	MatchSettings settings;
+	sf::Vector2u canvasSize;
+	float ballRadius = 0;
+	BallArrays balls;
+	OwnershipGrid map;
+	OwnedTiles owned;
+	std::vector<int> totalTiles;
+	std::vector<int> eliminationTick;
+	TeamRanking ranking;
+	sf::Time timer;
+	int tickCount = 0;
+	WorkerPool* workers = nullptr;
+	std::vector<BallHit> hits;
+	std::vector<std::vector<BallHit>> threadHits;
+	BallContacts contacts;
+	bool eventDriven = false;
+	std::priority_queue<Wakeup, std::vector<Wakeup>, std::greater<Wakeup>> schedule;
+	std::vector<sf::Uint8> checking;
+	std::vector<sf::Uint32> generation;
+	std::vector<int> awake;
+	std::vector<int> woken;
+	std::vector<int> merged;
+	std::vector<std::vector<Sleeper>> buckets;
+	sf::Vector2u bucketCount;
+};
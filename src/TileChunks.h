@@ -0,0 +1,211 @@
+// Tile map split into fixed-size chunks, each with its own vertex buffer.
+// Only the chunks that intersect the view are drawn and uploaded, so the
+// cost of a frame follows what is on screen rather than the map size.
+
+#pragma once
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+class TileChunks : public sf::Drawable
+{
+public:
+	static constexpr unsigned int ChunkSize = 64;
+
+	/// <summary>
+	/// Builds the chunks for a map of mapSize tiles, every tile starts
+	/// with the given color. Texture coordinates are world positions.
+	/// </summary>
+	void create(const sf::Vector2u& newMapSize, const sf::Vector2f& newTileSize, const sf::Color& color)
+	{
+		mapSize = newMapSize;
+		tileSize = newTileSize;
+		chunkCount = sf::Vector2u((mapSize.x + ChunkSize - 1) / ChunkSize, (mapSize.y + ChunkSize - 1) / ChunkSize);
+		chunks.clear();
+		chunks.resize(static_cast<size_t>(chunkCount.x) * chunkCount.y);
+		dirtyChunks.clear();
+		for (unsigned int cy = 0; cy < chunkCount.y; cy++)
+			for (unsigned int cx = 0; cx < chunkCount.x; cx++)
+			{
+				Chunk& chunk = chunks[cx + cy * chunkCount.x];
+				chunk.left = cx * ChunkSize;
+				chunk.top = cy * ChunkSize;
+				chunk.width = std::min(ChunkSize, mapSize.x - chunk.left);
+				chunk.height = std::min(ChunkSize, mapSize.y - chunk.top);
+				chunk.vertices.setPrimitiveType(sf::Triangles);
+				chunk.vertices.resize(static_cast<size_t>(chunk.width) * chunk.height * 6);
+				for (unsigned int i = 0; i < chunk.width; i++)
+					for (unsigned int j = 0; j < chunk.height; j++)
+					{
+						const float x = static_cast<float>(chunk.left + i);
+						const float y = static_cast<float>(chunk.top + j);
+						sf::Vertex* ptr = &chunk.vertices[(j + i * chunk.height) * 6];
+						ptr[0].position = sf::Vector2f(tileSize.x * x, tileSize.y * y);
+						ptr[1].position = sf::Vector2f(tileSize.x * (x + 1), tileSize.y * y);
+						ptr[2].position = sf::Vector2f(tileSize.x * (x + 1), tileSize.y * (y + 1));
+						ptr[3].position = sf::Vector2f(tileSize.x * x, tileSize.y * (y + 1));
+						for (int k = 0; k < 4; k++)
+						{
+							ptr[k].texCoords = ptr[k].position;
+							ptr[k].color = color;
+						}
+						ptr[4] = ptr[0];
+						ptr[5] = ptr[2];
+					}
+				if (sf::VertexBuffer::isAvailable())
+				{
+					chunk.buffer.create(chunk.vertices.getVertexCount());
+					chunk.buffer.setPrimitiveType(sf::Triangles);
+					chunk.buffer.setUsage(sf::VertexBuffer::Dynamic);
+					chunk.buffer.update(&chunk.vertices[0]);
+				}
+			}
+	}
+	const sf::Vector2u& getMapSize() const
+	{
+		return mapSize;
+	}
+	const sf::Vector2u& getChunkCount() const
+	{
+		return chunkCount;
+	}
+
+	/// <summary>
+	/// Recolors a tile. The change reaches the GPU on the next flush that
+	/// sees its chunk on screen.
+	/// </summary>
+	void setColor(unsigned int x, unsigned int y, const sf::Color& color)
+	{
+		const unsigned int cx = x / ChunkSize;
+		const unsigned int cy = y / ChunkSize;
+		const unsigned int index = cx + cy * chunkCount.x;
+		Chunk& chunk = chunks[index];
+		const unsigned int tile = (y - chunk.top) + (x - chunk.left) * chunk.height;
+		sf::Vertex* ptr = &chunk.vertices[tile * 6];
+		for (int k = 0; k < 6; k++)
+			ptr[k].color = color;
+		if (!chunk.dirty)
+		{
+			chunk.dirty = true;
+			dirtyChunks.push_back(index);
+		}
+		//past half of the chunk a full upload is cheaper than the spans
+		if (chunk.full)
+			return;
+		if (chunk.dirtyTiles.size() * 2 >= static_cast<size_t>(chunk.width) * chunk.height)
+		{
+			chunk.full = true;
+			chunk.dirtyTiles.clear();
+			return;
+		}
+		chunk.dirtyTiles.push_back(tile);
+	}
+
+	/// <summary>
+	/// Uploads the changes of every dirty chunk inside the view. Chunks
+	/// off screen stay dirty until they are scrolled into view.
+	/// </summary>
+	void flush(const sf::View& view)
+	{
+		if (dirtyChunks.empty())
+			return;
+		const sf::IntRect visible = visibleChunks(view);
+		size_t kept = 0;
+		for (unsigned int index : dirtyChunks)
+		{
+			Chunk& chunk = chunks[index];
+			if (!visible.contains(static_cast<int>(index % chunkCount.x), static_cast<int>(index / chunkCount.x)))
+			{
+				dirtyChunks[kept++] = index;
+				continue;
+			}
+			upload(chunk);
+			chunk.dirty = false;
+			chunk.full = false;
+			chunk.dirtyTiles.clear();
+		}
+		dirtyChunks.resize(kept);
+	}
+
+	/// <summary>
+	/// Range of chunks (in chunk coordinates) that the view can see.
+	/// Rotation of the view is ignored.
+	/// </summary>
+	sf::IntRect visibleChunks(const sf::View& view) const
+	{
+		const sf::Vector2f half = view.getSize() / 2.f;
+		const sf::Vector2f topLeft = view.getCenter() - half;
+		const sf::Vector2f bottomRight = view.getCenter() + half;
+		const sf::Vector2f chunkSize = sf::Vector2f(tileSize.x * ChunkSize, tileSize.y * ChunkSize);
+		const int left = std::max(0, static_cast<int>(std::floor(topLeft.x / chunkSize.x)));
+		const int top = std::max(0, static_cast<int>(std::floor(topLeft.y / chunkSize.y)));
+		const int right = std::min(static_cast<int>(chunkCount.x), static_cast<int>(std::floor(bottomRight.x / chunkSize.x)) + 1);
+		const int bottom = std::min(static_cast<int>(chunkCount.y), static_cast<int>(std::floor(bottomRight.y / chunkSize.y)) + 1);
+		return sf::IntRect(left, top, std::max(0, right - left), std::max(0, bottom - top));
+	}
+private:
+	struct Chunk
+	{
+		unsigned int left = 0;
+		unsigned int top = 0;
+		unsigned int width = 0;
+		unsigned int height = 0;
+		sf::VertexArray vertices;
+		sf::VertexBuffer buffer;
+		std::vector<unsigned int> dirtyTiles;
+		bool dirty = false;
+		bool full = false;
+	};
+
+	void upload(Chunk& chunk)
+	{
+		if (!sf::VertexBuffer::isAvailable())
+			return;
+		if (chunk.full)
+		{
+			chunk.buffer.update(&chunk.vertices[0]);
+			return;
+		}
+		//gaps shorter than MergeGap are uploaded along with the tiles around
+		//them as one extra call costs more than the few clean vertices in between
+		std::sort(chunk.dirtyTiles.begin(), chunk.dirtyTiles.end());
+		spans.clear();
+		for (unsigned int tile : chunk.dirtyTiles)
+		{
+			if (!spans.empty() && tile < spans.back().second + MergeGap)
+				spans.back().second = std::max(spans.back().second, tile + 1);
+			else
+				spans.emplace_back(tile, tile + 1);
+		}
+		if (spans.size() > MaxSpans)
+		{
+			chunk.buffer.update(&chunk.vertices[0]);
+			return;
+		}
+		for (auto& n : spans)
+			chunk.buffer.update(&chunk.vertices[n.first * 6], (n.second - n.first) * 6, n.first * 6);
+	}
+	void draw(sf::RenderTarget& target, sf::RenderStates states) const override
+	{
+		const sf::IntRect visible = visibleChunks(target.getView());
+		for (int cy = visible.top; cy < visible.top + visible.height; cy++)
+			for (int cx = visible.left; cx < visible.left + visible.width; cx++)
+			{
+				const Chunk& chunk = chunks[cx + cy * chunkCount.x];
+				if (sf::VertexBuffer::isAvailable())
+					target.draw(chunk.buffer, states);
+				else
+					target.draw(chunk.vertices, states);
+			}
+	}
+
+	static constexpr unsigned int MergeGap = 64;
+	static constexpr size_t MaxSpans = 32;
+	std::vector<Chunk> chunks;
+	std::vector<unsigned int> dirtyChunks;
+	std::vector<std::pair<unsigned int, unsigned int>> spans;
+	sf::Vector2u mapSize;
+	sf::Vector2f tileSize;
+	sf::Vector2u chunkCount;
+};
@@ -0,0 +1,167 @@
+// Estimates how likely every team is to win a live match. Snapshots of the
+// match go to a background thread that plays many short randomized
+// continuations of it on a worker pool of its own. The game only swaps
+// arrays under a lock, so a slow estimate never holds up a frame.
+
+#pragma once
+#include <SFML/System.hpp>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cmath>
+#include <algorithm>
+#include "Simulation.h"
+#include "WorkerPool.h"
+
+class WinEstimator
+{
+public:
+	~WinEstimator()
+	{
+		stop();
+	}
+
+	/// <summary>
+	/// Starts the background thread. Every snapshot is played rollouts
+	/// times for up to horizon ticks of tickDelta each.
+	/// </summary>
+	/// <param name="threads">Threads for the rollouts, 0 leaves one core to the game</param>
+	void create(int newRollouts, int newHorizon, const sf::Time& newTickDelta, unsigned int threads = 0)
+	{
+		stop();
+		rollouts = std::max(1, newRollouts);
+		horizon = std::max(1, newHorizon);
+		tickDelta = newTickDelta;
+		threadCount = threads == 0 ? std::max(2u, std::thread::hardware_concurrency()) - 1 : threads;
+		quit = false;
+		pending = false;
+		busy = false;
+		estimate.clear();
+		estimateTick = -1;
+		thread = std::thread([this]() { Loop(); });
+	}
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+		wake.notify_all();
+		if (thread.joinable())
+			thread.join();
+	}
+	/// <summary>
+	/// Whether a snapshot is still waiting or being played, a new one would
+	/// only replace it.
+	/// </summary>
+	bool isBusy() const
+	{
+		return busy;
+	}
+
+	/// <summary>
+	/// Hands the snapshot over by swapping it with a spare one, so the arrays
+	/// of both are reused. A snapshot that is still waiting is replaced.
+	/// </summary>
+	void submit(MatchSnapshot& snapshot)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			std::swap(snapshot, next);
+			pending = true;
+			busy = true;
+		}
+		wake.notify_one();
+	}
+
+	/// <summary>
+	/// Copies the latest estimate, the share of the rollouts each team won.
+	/// Returns the tick of the snapshot it was made from, -1 before the first.
+	/// </summary>
+	int getEstimate(std::vector<float>& chances) const
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		chances = estimate;
+		return estimateTick;
+	}
+private:
+	void Loop()
+	{
+		WorkerPool pool(threadCount);
+		const int tasks = static_cast<int>(pool.getThreadCount());
+		//a match per task, loading a snapshot reuses its memory
+		std::vector<Simulation> sims(tasks);
+		for (auto& n : sims)
+			n.setEventDriven(true);
+		std::vector<std::vector<int>> wins(tasks);
+		std::vector<float> chances;
+		MatchSnapshot current;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [this]() { return quit || pending; });
+				if (quit)
+					return;
+				std::swap(current, next);
+				pending = false;
+			}
+			const int teams = current.teamCount;
+			pool.run(tasks, [&](int t)
+				{
+					wins[t].assign(teams, 0);
+					for (int r = t; r < rollouts && !quit; r += tasks)
+						wins[t][Rollout(sims[t], current, r)]++;
+				});
+			chances.assign(teams, 0.f);
+			for (const auto& n : wins)
+				for (int i = 0; i < teams; i++)
+					chances[i] += static_cast<float>(n[i]) / rollouts;
+			std::lock_guard<std::mutex> lock(mutex);
+			if (quit)
+				return;
+			estimate.swap(chances);
+			estimateTick = current.tickCount;
+			busy = pending;
+		}
+	}
+	/// <summary>
+	/// Plays one continuation and returns the team leading at its end.
+	/// </summary>
+	int Rollout(Simulation& sim, const MatchSnapshot& snapshot, int index) const
+	{
+		sim.loadSnapshot(snapshot);
+		//turning every ball a little is enough for the continuations to part ways
+		zle::Random random(snapshot.seed + snapshot.tickCount, StreamID(RandomStream::Rollout, static_cast<sf::Uint32>(index)));
+		const BallArrays& balls = sim.getBalls();
+		for (int i = 0; i < static_cast<int>(balls.size()); i++)
+		{
+			if (!balls.alive[i])
+				continue;
+			const float angle = (random.nextFloat() * 2 - 1) * MaxTurn;
+			const float c = std::cos(angle);
+			const float s = std::sin(angle);
+			sim.Steer(i, sf::Vector2f(balls.dx[i] * c - balls.dy[i] * s, balls.dx[i] * s + balls.dy[i] * c));
+		}
+		for (int t = 0; t < horizon && !sim.isFinished() && !quit; t++)
+			sim.Tick(tickDelta);
+		return sim.getRanking().Leader();
+	}
+
+	static constexpr float MaxTurn = 0.15f;
+	int rollouts = 256;
+	int horizon = 3600;
+	sf::Time tickDelta;
+	unsigned int threadCount = 1;
+	std::thread thread;
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	std::atomic<bool> quit{false};
+	std::atomic<bool> busy{false};
+	bool pending = false;
+	MatchSnapshot next;
+	std::vector<float> estimate;
+	int estimateTick = -1;
+};
@@ -0,0 +1,122 @@
+// Small fixed-size thread pool used to spread per-tick work over cores.
+// The calling thread takes part in every job, so a pool of one thread
+// runs everything inline without any synchronization.
+
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+
+class WorkerPool
+{
+public:
+	WorkerPool() {}
+	explicit WorkerPool(unsigned int threads)
+	{
+		create(threads);
+	}
+	~WorkerPool()
+	{
+		stop();
+	}
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	/// <summary>
+	/// Starts threads - 1 workers, the caller is the remaining thread.
+	/// 0 uses one thread per hardware core.
+	/// </summary>
+	void create(unsigned int threads)
+	{
+		stop();
+		if (threads == 0)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		quit = false;
+		for (unsigned int i = 1; i < threads; i++)
+			workers.emplace_back([this]() { WorkerLoop(); });
+	}
+	unsigned int getThreadCount() const
+	{
+		return static_cast<unsigned int>(workers.size()) + 1;
+	}
+
+	/// <summary>
+	/// Calls func(task) for every task in [0, tasks) and returns once all
+	/// of them finished. Tasks are handed out dynamically, so func must not
+	/// depend on which thread runs it.
+	/// </summary>
+	void run(int tasks, const std::function<void(int)>& func)
+	{
+		if (workers.empty() || tasks <= 1)
+		{
+			for (int i = 0; i < tasks; i++)
+				func(i);
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job = &func;
+			taskCount = tasks;
+			nextTask = 0;
+			busy = static_cast<int>(workers.size());
+			generation++;
+		}
+		wake.notify_all();
+		RunTasks(func);
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this]() { return busy == 0; });
+		job = nullptr;
+	}
+private:
+	void RunTasks(const std::function<void(int)>& func)
+	{
+		for (int i = nextTask++; i < taskCount; i = nextTask++)
+			func(i);
+	}
+	void WorkerLoop()
+	{
+		unsigned int seen = 0;
+		while (true)
+		{
+			const std::function<void(int)>* current;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&]() { return quit || generation != seen; });
+				if (quit)
+					return;
+				seen = generation;
+				current = job;
+			}
+			RunTasks(*current);
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--busy == 0)
+				done.notify_one();
+		}
+	}
+	void stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quit = true;
+		}
+		wake.notify_all();
+		for (auto& n : workers)
+			n.join();
+		workers.clear();
+	}
+
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	const std::function<void(int)>* job = nullptr;
+	std::atomic<int> nextTask{0};
+	int taskCount = 0;
+	int busy = 0;
+	unsigned int generation = 0;
+	bool quit = false;
+};
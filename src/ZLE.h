@@ -421,6 +421,87 @@ namespace zle
 				target.draw(arr, states);
 		}
 	};
+	/// <summary>
+	/// Small seedable random generator (xoshiro128**) with 16 bytes of state.
+	/// Generators built from the same seed and different streams produce
+	/// independent sequences, so every subsystem, emitter or object can own
+	/// one and stay reproducible no matter the order they are used in.
+	/// </summary>
+	class Random
+	{
+		uint32_t state[4];
+		static uint32_t rotl(uint32_t x, int k)
+		{
+			return (x << k) | (x >> (32 - k));
+		}
+		static uint64_t splitMix64(uint64_t& x)
+		{
+			uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+	public:
+		typedef uint32_t result_type;
+
+		Random(uint64_t seed = 0, uint64_t stream = 0)
+		{
+			setSeed(seed, stream);
+		}
+
+		/// <summary>
+		/// Restarts the generator on the given seed and stream.
+		/// </summary>
+		void setSeed(uint64_t seed, uint64_t stream = 0)
+		{
+			uint64_t x = seed;
+			x = splitMix64(x) ^ stream;
+			const uint64_t a = splitMix64(x);
+			const uint64_t b = splitMix64(x);
+			state[0] = static_cast<uint32_t>(a);
+			state[1] = static_cast<uint32_t>(a >> 32);
+			state[2] = static_cast<uint32_t>(b);
+			state[3] = static_cast<uint32_t>(b >> 32);
+			if ((state[0] | state[1] | state[2] | state[3]) == 0)
+				state[0] = 1;
+		}
+		static constexpr result_type min()
+		{
+			return 0;
+		}
+		static constexpr result_type max()
+		{
+			return 0xFFFFFFFFu;
+		}
+		result_type operator()()
+		{
+			const uint32_t result = rotl(state[1] * 5, 7) * 9;
+			const uint32_t t = state[1] << 9;
+			state[2] ^= state[0];
+			state[3] ^= state[1];
+			state[1] ^= state[2];
+			state[0] ^= state[3];
+			state[2] ^= t;
+			state[3] = rotl(state[3], 11);
+			return result;
+		}
+
+		/// <summary>
+		/// Returns a value in [0, 1).
+		/// </summary>
+		float nextFloat()
+		{
+			return static_cast<float>((*this)() >> 8) * (1.f / 16777216.f);
+		}
+
+		/// <summary>
+		/// Returns a value in [0, bound).
+		/// </summary>
+		uint32_t nextInt(uint32_t bound)
+		{
+			return static_cast<uint32_t>((static_cast<uint64_t>((*this)()) * bound) >> 32);
+		}
+	};
 	class ParticleSystemEvent
 	{
 	public:
@@ -552,7 +633,7 @@ namespace zle
 		bool inherit[3][ParticleSystemEvent::Count];
 
 		//random items
-		std::mt19937 randomFunc;
+		Random randomFunc;
 		float r_lifeTime;
 		float r_startSpeed;
 		float r_endSpeed;
@@ -642,15 +723,15 @@ namespace zle
 		}
 		float getRandomValueTrig()
 		{
-			return static_cast<float>(randomFunc()) / randomFunc.max() * 6.283184f;
+			return randomFunc.nextFloat() * 6.283184f;
 		}
 		float getRandomValue01()
 		{
-			return static_cast<float>(randomFunc()) / randomFunc.max();
+			return randomFunc.nextFloat();
 		}
 		float getRandomValue11()
 		{
-			return static_cast<float>(randomFunc()) / (randomFunc.max() / 2) - 1;
+			return randomFunc.nextFloat() * 2 - 1;
 		}
 		int findFreeParticle()
 		{
@@ -800,7 +881,7 @@ namespace zle
 			randomStartRotation(0), createOnUpdate(1), texture(nullptr), firstUpdate(0), keepUpWithFrameRate(0),
 			drawNewestOnTop(1), fireAngle(360.f), fireRotation(0), spawnRadius(0), r_lifeTime(0),
 			r_endSize(0), r_startSize(0), r_startSpeed(0), r_endSpeed(0), r_useSecondary(0), r_secondaryEnd(255, 255, 255, 255), r_secondaryStart(255, 255, 255, 255),
-			randomFunc(time(nullptr)), BothColors(true)
+			randomFunc(static_cast<uint64_t>(time(nullptr)), reinterpret_cast<uintptr_t>(this)), BothColors(true)
 		{
 			for (int i = 0; i < ParticleSystemEvent::Count; i++)
 			{
@@ -972,6 +1053,15 @@ namespace zle
 			return maxParticles;
 		}
 
+		/// <summary>
+		/// Returns how long the last call to Update() took.
+		/// </summary>
+		/// <returns>Reference to the update time</returns>
+		const sf::Time& getUpdateTime() const
+		{
+			return updateTime;
+		}
+
 		/// <summary>
 		/// Returns the base life time of a particle.
 		/// </summary>
@@ -1664,6 +1754,17 @@ namespace zle
 			spawnRadius = radius;
 		}
 
+		/// <summary>
+		/// Reseeds the generator used for spawn directions, positions, sizes and colors.
+		/// By default every particle system is seeded from the clock.
+		/// </summary>
+		/// <param name="seed">Seed shared by all systems of a run</param>
+		/// <param name="stream">Stream of this system, different streams give independent sequences</param>
+		void setRandomSeed(uint64_t seed, uint64_t stream = 0)
+		{
+			randomFunc.setSeed(seed, stream);
+		}
+
 		/// <summary>
 		/// Deletes all particles.
 		/// </summary>
@@ -1,32 +1,23 @@
 #include <SFML/Graphics.hpp>
 #include "ZLE.h"
+#include "Simulation.h"
+#include "Replay.h"
+#include "TileChunks.h"
+#include "GameConfig.h"
+#include "NumberText.h"
+#include "OwnershipTexture.h"
+#include "FrameProfiler.h"
+#include "EffectsGovernor.h"
+#include "FrameReadback.h"
+#include "FrameEncoder.h"
+#include "WinEstimator.h"
 #include <vector>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <cmath>
 using namespace sf;
 using namespace std;
-//#define TIMERMODE
-//#define CONTROLLABLE
-//#define SWAPCOLORS
-//#define BORNAMODE
-#define FANCYMODE
-bool Circle_Rectangle(const sf::Vector2f& pos1, const float radius1, const sf::FloatRect& rectangle)
-{
-    sf::Vector2f tests = pos1;
-    if (pos1.x < rectangle.left)
-        tests.x = rectangle.left;
-    else if (pos1.x > rectangle.left + rectangle.width)
-        tests.x = rectangle.left + rectangle.width;
-
-    if (pos1.y < rectangle.top)
-        tests.y = rectangle.top;
-    else if (pos1.y > rectangle.top + rectangle.height)
-        tests.y = rectangle.top + rectangle.height;
-
-    sf::Vector2f dist = sf::Vector2f(pos1.x - tests.x, pos1.y - tests.y);
-    float distanceSqr = (dist.x * dist.x) + (dist.y * dist.y);
-    if (distanceSqr <= radius1 * radius1)
-        return 1;
-    return 0;
-}
 Vector2f normalize(const Vector2f& arg)
 {
     float len = arg.x * arg.x + arg.y * arg.y;
@@ -36,87 +27,135 @@ Vector2f normalize(const Vector2f& arg)
 }
 class ToInfinity
 {
-    struct Ball
-    {
-        CircleShape ball;
-        Vector2f dir;
-        bool dead = false;
-    };
-    int ballCount = 4;
+    GameConfig config;
+    MatchSettings settings;
+    Simulation sim;
+    int teamCount = 4;
     //vector<Color> ballColors = { Color(255, 50, 40), Color(255, 255, 255), Color(242, 174, 14), Color(5, 107, 14) };
     //vector<Color> bgColor = { Color(0, 0, 0), Color(200, 30, 0), Color(200, 200, 200), Color(207, 154, 10), Color(11, 87, 18) };
-    vector<Color> ballColors = { Color(255, 50, 40), Color(0x5AFFFFFF), Color(242, 174, 14), Color(5, 107, 14) };
-    vector<Color> bgColor = { Color(0, 0, 0), Color(200, 30, 0), Color(0x99E6E6FF), Color(207, 154, 10), Color(11, 87, 18) };
+    vector<Color> ballColors;
+    vector<Color> bgColor;
     //vector<Color> ballColors;
     //vector<Color> bgColor;
     //vector<Vector2f> ballPos;
-    const float ballSpeed = 800.f;
-    const Vector2u canvasSize = Vector2u(1920, 1080);
-    const Vector2u mapSize = Vector2u(16, 9) * 2U;
-    const float ballRadius = (static_cast<float>(canvasSize.x) / mapSize.x) / 4;
-    vector<Vector2f> ballPos = { Vector2f(canvasSize.x / 4, canvasSize.y / 4), Vector2f(canvasSize.x / 4 * 3, canvasSize.y / 4),
-        Vector2f(canvasSize.x / 4, canvasSize.y / 4 * 3), Vector2f(canvasSize.x / 4 * 3, canvasSize.y / 4 * 3) };
-    vector<vector<Uint8>> map;
+    const Vector2u screenSize = Vector2u(1920, 1080);
+    Vector2u canvasSize;
+    Vector2f tileSize;
+    float ballRadius = 0;
     RenderWindow window;
-    VertexArray arr;
-    VertexBuffer buff;
-    vector<Ball> balls;
+    TileChunks tiles;
+    OwnershipTexture tileTexture;
+    bool textureTiles = false;
+    WorkerPool workers;
+    vector<CircleShape> ballShapes;
     View view;
+    View hudView;
+    const float minViewTiles = 4;
+    bool panning = false;
+    Vector2i panStart;
     Font font;
-    vector<Text> counters;
-    vector<int> totalTiles;
+    NumberText labels;
+    vector<int> counters;
+    vector<int> shownTiles;
     int highestID = 0;
-    int lowestID = 0;
     vector<zle::ParticleSystem> wallBreak;
     vector<zle::ParticleSystem> ballTrail;
     zle::ParticleSystem snowFlakeSystem;
-    Clock snowFlakeClock;
+    Time snowFlakeTime;
+    Time shaderTime;
+    zle::Random tileBreakRandom;
+    zle::Random snowFallRandom;
     Texture circle;
     Texture snowFlakeTexture;
     Image img;
 
-    const int totalTimerCnt = 60;
-    const int swapColorsCnt = 40;
-    Text timerText;
-    Time timer = seconds(totalTimerCnt);
-    Time swapColors = seconds(swapColorsCnt);
+    int timerText = -1;
+    Time swapColors;
 
     Shader bgShader;
+    Shader paletteShader;
+    Shader gridShader;
+    Texture palette;
+    bool indexedTiles = false;
+    bool headless = false;
+    float tickRate = 120.f;
+    Replay replay;
+    Replay::State playback;
+    string recordPath;
+    int keyframeInterval = 600;
+    bool replaying = false;
+    bool paused = false;
+    const int seekTicks = 5 * 120;
+    int fastForward = 1;
+    const vector<int> fastForwardSteps = { 1, 10, 100 };
+    const int maxTicksPerFrame = 2000;
+    bool effects = true;
+    FrameProfiler profiler;
+    string tracePath;
+    int speedText = -1;
+    const Time maxFrameTime = seconds(0.25f);
+    //effect amounts per governor level, a slow machine drops sparkle before frames
+    struct EffectsLevel
+    {
+        int breakParticles;
+        int trailSteps;
+        float snowInterval;
+    };
+    const vector<EffectsLevel> effectsLevels = { { 20, 4, 1.f }, { 12, 3, 1.5f }, { 6, 2, 2.5f }, { 3, 1, 5.f }, { 1, 1, 0.f } };
+    EffectsGovernor governor;
+    //win chances of a live match, played out on other cores from snapshots of it
+    bool estimating = false;
+    WinEstimator winEstimator;
+    MatchSnapshot snapshot;
+    vector<int> chanceTexts;
+    vector<float> chances;
+    int chanceTick = -1;
+    Time estimateWait;
+    const Time estimateInterval = seconds(1);
 public:
-    bool Collided(int ballID, Vector2i& collisionTile)
+    void BreakTile(const Vector2i& tile, int index)
     {
-        //collision
-        const Vector2f tileSize = Vector2f(static_cast<float>(canvasSize.x) / mapSize.x, static_cast<float>(canvasSize.y) / mapSize.y);
-        for (int j = -1; j <= 1; j++)
+        if (headless)
+            return;
+        for (int i = 0; i < Effects().breakParticles; i++)
         {
-            int coordX = balls[ballID].ball.getPosition().x / tileSize.x + j;
-            if (coordX < 0 || coordX >= mapSize.x)
-                continue;
-            for (int k = -1; k <= 1; k++)
-            {
-                int coordY = balls[ballID].ball.getPosition().y / tileSize.y + k;
-                if (coordY < 0 || coordY >= mapSize.y)
-                    continue;
-                bool enemyColor = map[coordX][coordY] != ballID + 1;
-                bool collision = enemyColor && Circle_Rectangle(balls[ballID].ball.getPosition(), balls[ballID].ball.getRadius(),
-                    FloatRect(tileSize.x * coordX, tileSize.y * coordY, tileSize.x, tileSize.y));
-                if (collision)
-                {
-                    collisionTile = Vector2i(coordX, coordY);
-                    int index = map[coordX][coordY];
-                    for (int i = 0; i < 20; i++)
-                    {
-                        Vector2f randPos;
-                        randPos.x = coordX * tileSize.x + tileSize.x / 2 + (static_cast<float>(rand()) / RAND_MAX - 0.5) * (tileSize.x - wallBreak[index].getStartSize());
-                        randPos.y = coordY * tileSize.y + tileSize.y / 2 + (static_cast<float>(rand()) / RAND_MAX - 0.5) * (tileSize.y - wallBreak[index].getStartSize());
-                        wallBreak[index].setSpawnPosition(randPos);
-                        wallBreak[index].Create();
-                    }
-                    return true;
-                }
-            }
+            Vector2f randPos;
+            randPos.x = tile.x * tileSize.x + tileSize.x / 2 + (tileBreakRandom.nextFloat() - 0.5) * (tileSize.x - wallBreak[index].getStartSize());
+            randPos.y = tile.y * tileSize.y + tileSize.y / 2 + (tileBreakRandom.nextFloat() - 0.5) * (tileSize.y - wallBreak[index].getStartSize());
+            wallBreak[index].setSpawnPosition(randPos);
+            wallBreak[index].Create();
         }
-        return false;
+    }
+    void TileChanged(const Vector2i& tile, int previous, int owner)
+    {
+        if (headless)
+            return;
+        if (owner > 0 && effects)
+            BreakTile(tile, previous);
+        SetTile(tile.x, tile.y, owner);
+    }
+    void SetTile(unsigned int x, unsigned int y, int owner)
+    {
+        if (textureTiles)
+            tileTexture.setOwner(x, y, owner);
+        else
+            tiles.setColor(x, y, TileColor(owner));
+    }
+    //with shaders the tiles only carry their owner in the red channel and the
+    //shader looks the color up in the palette, so recoloring touches no vertices
+    Color TileColor(int owner) const
+    {
+        return indexedTiles ? Color(owner, 0, 0) : bgColor[owner];
+    }
+    void UpdatePalette()
+    {
+        if (!indexedTiles)
+            return;
+        Image colors;
+        colors.create(256, 1, Color::Black);
+        for (int i = 0; i < bgColor.size() && i < 256; i++)
+            colors.setPixel(i, 0, bgColor[i]);
+        palette.update(colors);
     }
     void GenCircle()
     {
@@ -127,6 +166,46 @@ public:
                     img.setPixel(i, j, Color::White);
         circle.loadFromImage(img);
     }
+    void SetupSimulation()
+    {
+        sim.setWorkers(&workers);
+        const bool recording = !recordPath.empty() && !replaying;
+        if (!headless || recording)
+            sim.onTileChanged = [this, recording](const Vector2i& tile, int previous, int owner)
+            {
+                if (recording)
+                    replay.RecordTile(tile, owner);
+                TileChanged(tile, previous, owner);
+            };
+        sim.Setup(settings);
+        //the recording goes to the file as the match runs, so a crash only loses the last segment
+        if (recording)
+        {
+            replay.Begin(sim, tickRate, keyframeInterval);
+            if (!replay.openFile(recordPath))
+                cout << "Could not open " << recordPath << "\n";
+        }
+        if (replaying)
+            replay.Seek(playback, 0);
+        teamCount = sim.getSettings().teamCount;
+        canvasSize = sim.getCanvasSize();
+        tileSize = sim.getTileSize();
+        ballRadius = sim.getBallRadius();
+        shownTiles.assign(teamCount, 0);
+        highestID = sim.getRanking().Leader();
+        PadPalettes();
+    }
+    //short palettes and replays with more teams reuse the colors from the start,
+    //the shader reads the tile colors up to index 4
+    void PadPalettes()
+    {
+        const size_t balls = ballColors.size();
+        while (ballColors.size() < teamCount)
+            ballColors.push_back(ballColors[ballColors.size() - balls]);
+        const size_t owners = bgColor.size() - 1;
+        while (bgColor.size() < max(teamCount + 1, 5))
+            bgColor.push_back(owners > 0 ? bgColor[bgColor.size() - owners] : bgColor[0]);
+    }
     void Start()
     {
 #ifdef SFML_SYSTEM_EMSCRIPTEN
@@ -135,7 +214,56 @@ public:
         window.create(VideoMode(1920, 1080), "ToInfinity", Style::None);
 #endif
         window.setVerticalSyncEnabled(1);
-
+        estimating = config.winEstimate && !replaying;
+#ifdef __EMSCRIPTEN__
+        //no spare threads to play the rollouts on
+        estimating = false;
+#endif
+        Setup();
+        if (estimating)
+            winEstimator.create(config.winRollouts, static_cast<int>(config.winHorizon.asSeconds() * tickRate), seconds(1.f / tickRate));
+        Update();
+        winEstimator.stop();
+        SaveRecording();
+        if (!tracePath.empty())
+            SaveTrace(tracePath);
+    }
+    //renders the match into a texture at a fixed frame rate as fast as the machine can,
+    //without a window or vsync, until the tick count or the end of the match
+    bool StartRender(const string& path, int ticks, float fps)
+    {
+        RenderTexture frame;
+        if (!frame.create(screenSize.x, screenSize.y))
+        {
+            cout << "Could not create a " << screenSize.x << "x" << screenSize.y << " render texture\n";
+            return false;
+        }
+        Setup();
+        FrameEncoder encoder;
+        if (!encoder.open(path, screenSize))
+        {
+            cout << "Could not open " << path << "\n";
+            return false;
+        }
+        FrameReadback readback;
+        readback.create(frame);
+        Clock clock;
+        const int mode = config.swapColors | config.fancy << 1;
+        RenderModes(mode, make_integer_sequence<int, 4>(), frame, readback, encoder, ticks, seconds(1.f / max(fps, 1.f)));
+        const bool written = encoder.close();
+        const float elapsed = clock.getElapsedTime().asSeconds();
+        cout << "Rendered " << encoder.getFrameCount() << " frames (" << encoder.getFrameCount() / max(fps, 1.f) << " s at " << fps << " fps) in "
+            << elapsed << " s (" << (elapsed > 0 ? encoder.getFrameCount() / elapsed : 0) << " frames/s" << (readback.isAsync() ? "" : ", synchronous readback") << ")\n";
+        if (!written)
+            cout << "Could not write every frame to " << path << "\n";
+        SaveRecording();
+        if (!tracePath.empty())
+            SaveTrace(tracePath);
+        return written;
+    }
+    //everything but the window, shared by the live game and the video render
+    void Setup()
+    {
         //bgColor.emplace_back(Color::Black);
         //for (int i = 0; i < 20; i++)
         //{
@@ -145,9 +273,10 @@ public:
         //    bgColor.emplace_back(Color(ballColors.back().r - 50, ballColors.back().g - 50, ballColors.back().b - 50));
         //}
 
-        balls.resize(ballCount);
-        wallBreak.resize(ballCount + 1);
-        ballTrail.resize(ballCount);
+        SetupSimulation();
+        wallBreak.resize(teamCount + 1);
+        ballTrail.resize(teamCount);
+        ballShapes.resize(teamCount);
         GenCircle();
 
         snowFlakeTexture.loadFromFile("snowflake.png");
@@ -161,24 +290,24 @@ public:
         snowFlakeSystem.setEndRotation(1080);
         snowFlakeSystem.setRandomStartSize(10);
         snowFlakeSystem.setFading(0.5);
+        snowFlakeSystem.setRandomSeed(settings.seed, StreamID(RandomStream::SnowEmitter));
+        tileBreakRandom.setSeed(settings.seed, StreamID(RandomStream::TileBreak));
+        snowFallRandom.setSeed(settings.seed, StreamID(RandomStream::SnowFall));
 
-        for (int i = 0; i < balls.size(); i++)
+        for (int i = 0; i < teamCount; i++)
         {
-            balls[i].ball.setRadius(ballRadius);
-            balls[i].ball.setPosition(ballPos[i]);
-            balls[i].ball.setOrigin(balls[i].ball.getRadius(), balls[i].ball.getRadius());
-            balls[i].dir = Vector2f(1 + rand() % 2 * -2, 1 + rand() % 2 * -2);
-            balls[i].ball.move((static_cast<float>(rand()) / RAND_MAX * 2 - 1) * canvasSize.x / 10.f,
-                        (static_cast<float>(rand()) / RAND_MAX * 2 - 1) * canvasSize.y / 10.f);
-            balls[i].ball.setFillColor(ballColors[i]);
+            ballShapes[i].setRadius(ballRadius);
+            ballShapes[i].setOrigin(ballRadius, ballRadius);
+            ballShapes[i].setFillColor(ballColors[i]);
             ballTrail[i].loadFromFile("ballTrail.psy");
             ballTrail[i].setTexture(&circle);
             ballTrail[i].useBothColors(false);
             ballTrail[i].setStartColor(ballColors[i]);
             ballTrail[i].setCreateOnUpdate(false);
-            ballTrail[i].setStartSize(balls[i].ball.getRadius() / 1.3);
-            ballTrail[i].setEndSize(balls[i].ball.getRadius() / 10);
+            ballTrail[i].setStartSize(ballRadius / 1.3);
+            ballTrail[i].setEndSize(ballRadius / 10);
             ballTrail[i].setLifeTime(0.3);
+            ballTrail[i].setRandomSeed(settings.seed, StreamID(RandomStream::BallTrailEmitter, i));
         }
         for (int i = 0; i < wallBreak.size(); i++)
         {
@@ -186,334 +315,745 @@ public:
             wallBreak[i].setCreateOnUpdate(false);
             wallBreak[i].setStartColor(bgColor[i]);
             wallBreak[i].setEndColor(bgColor[i]);
-            wallBreak[i].setStartSize(static_cast<float>(canvasSize.x) / mapSize.x / 3);
+            wallBreak[i].setStartSize(tileSize.x / 3);
             wallBreak[i].setMaxParticles(200);
         }
         wallBreak[0].setMaxParticles(1000);
+        for (int i = 0; i < wallBreak.size(); i++)
+            wallBreak[i].setRandomSeed(settings.seed, StreamID(RandomStream::WallBreakEmitter, i));
 
-        view.reset(FloatRect(0, 0, canvasSize.x, canvasSize.y));
-        map.resize(mapSize.x);
-        for (auto& n : map)
-            n.resize(mapSize.y);
-
-        counters.resize(balls.size());
-        totalTiles.resize(balls.size());
+        hudView.reset(FloatRect(0, 0, screenSize.x, screenSize.y));
+        ResetView();
 
-        arr.resize(6 * mapSize.x * mapSize.y);
-        arr.setPrimitiveType(Triangles);
-        const Vector2f tileSize = Vector2f(static_cast<float>(canvasSize.x) / mapSize.x, static_cast<float>(canvasSize.y) / mapSize.y);
-        for (int i = 0; i < mapSize.x; i++)
-            for (int j = 0; j < mapSize.y; j++)
+        if (Shader::isAvailable() && palette.create(256, 1))
+        {
+            //the whole map as one quad over an ownership texture when it fits, vertex chunks otherwise
+            if (config.tileTexture && tileTexture.create(sim.getMap().getSize(), tileSize) && gridShader.loadFromFile("defaultVertex.glsl", "gridShader.glsl"))
             {
-                map[i][j] = 0;
-
-                Vertex* ptr = &arr[(j + i * mapSize.y) * 6];
-                ptr[0].position = Vector2f(tileSize.x * i, tileSize.y * j);
-                ptr[1].position = Vector2f(tileSize.x * (i + 1), tileSize.y * j);
-                ptr[2].position = Vector2f(tileSize.x * (i + 1), tileSize.y * (j + 1));
-                ptr[3].position = Vector2f(tileSize.x * i, tileSize.y * (j + 1));
-                for (int k = 0; k < 4; k++)
-                {
-                    ptr[k].texCoords = ptr[k].position;
-                    ptr[k].color = bgColor[map[i][j]];
-                }
-
-                ptr[4] = ptr[0];
-                ptr[5] = ptr[2];
+                textureTiles = true;
+                indexedTiles = true;
+                gridShader.setUniform("ownership", tileTexture.getTexture());
+                gridShader.setUniform("palette", palette);
+                gridShader.setUniform("mapSize", Glsl::Vec2(Vector2f(sim.getMap().getSize())));
+                gridShader.setUniform("tileSize", Glsl::Vec2(tileSize));
+                gridShader.setUniform("fancy", config.fancy);
+                gridShader.setUniform("goldColor", Glsl::Vec4(bgColor[3].r / 255.f, bgColor[3].g / 255.f, bgColor[3].b / 255.f, 1));
+                gridShader.setUniform("whiteColor", Glsl::Vec4(bgColor[2].r / 255.f, bgColor[2].g / 255.f, bgColor[2].b / 255.f, 1));
+                gridShader.setUniform("greenColor", Glsl::Vec4(bgColor[4].r / 255.f, bgColor[4].g / 255.f, bgColor[4].b / 255.f, 1));
+            }
+            else if (config.fancy)
+            {
+                indexedTiles = bgShader.loadFromFile("defaultVertex.glsl", "bgShader.glsl");
+                bgShader.setUniform("goldColor", Glsl::Vec4(bgColor[3].r / 255.f, bgColor[3].g / 255.f, bgColor[3].b / 255.f, 1));
+                bgShader.setUniform("whiteColor", Glsl::Vec4(bgColor[2].r / 255.f, bgColor[2].g / 255.f, bgColor[2].b / 255.f, 1));
+                bgShader.setUniform("greenColor", Glsl::Vec4(bgColor[4].r / 255.f, bgColor[4].g / 255.f, bgColor[4].b / 255.f, 1));
+                bgShader.setUniform("palette", palette);
             }
-        buff.create(arr.getVertexCount());
-        buff.setPrimitiveType(Triangles);
-        buff.update(&arr[0]);
+            else
+            {
+                indexedTiles = paletteShader.loadFromFile("defaultVertex.glsl", "paletteShader.glsl");
+                paletteShader.setUniform("palette", palette);
+            }
+            UpdatePalette();
+        }
+        if (!textureTiles)
+            tiles.create(sim.getMap().getSize(), tileSize, TileColor(0));
 
+        //the counters, the timer and the speed share one set of glyphs baked at the counter size
         font.loadFromFile("Montserrat.ttf");
-        timerText.setFont(font);
-        timerText.setCharacterSize(50);
-        timerText.setPosition(Vector2f(canvasSize.x / 30, canvasSize.y / 30));
+        labels.create(font, 80, 3, Color(255, 255, 255, 96), "x%");
+        timerText = labels.addField(Vector2f(screenSize.x / 30, screenSize.y / 30), 50, Color::White, NumberText::Align::Left);
+        speedText = labels.addField(Vector2f(screenSize.x - screenSize.x / 30, screenSize.y / 30), 50, Color::White, NumberText::Align::Right, 4, "x");
+        SetFastForward(fastForward);
+        counters.resize(teamCount);
         for (int i = 0; i < counters.size(); i++)
         {
-            counters[i].setFont(font);
-            counters[i].setFillColor(ballColors[i]);
-            counters[i].setOutlineColor(Color(255, 255, 255, 96));
-            counters[i].setOutlineThickness(0);
-            counters[i].setCharacterSize(80);
-            counters[i].setPosition(canvasSize.x / 2 + (static_cast<float>(i) / (counters.size() - 1) - 0.5) * canvasSize.x / 2, canvasSize.y / 10 * 9);
-
-            totalTiles[i] = 0;
-            counters[i].setString("0");
-            counters[i].setOrigin(counters[i].getLocalBounds().width / 2, counters[i].getLocalBounds().height / 2);
+            const float spread = counters.size() > 1 ? static_cast<float>(i) / (counters.size() - 1) - 0.5f : 0;
+            counters[i] = labels.addField(Vector2f(screenSize.x / 2 + spread * screenSize.x / 2, screenSize.y / 10 * 9), 80, ballColors[i], NumberText::Align::Center);
+            labels.setValue(counters[i], 0);
+            if (estimating)
+                chanceTexts.push_back(labels.addField(Vector2f(screenSize.x / 2 + spread * screenSize.x / 2, screenSize.y / 10 * 9 + 70), 40, ballColors[i], NumberText::Align::Center, 3, "", "%"));
         }
-#ifdef FANCYMODE
-        bgShader.loadFromFile("defaultVertex.glsl", "bgShader.glsl");
-        bgShader.setUniform("goldColor", Glsl::Vec4(bgColor[3].r / 255.f, bgColor[3].g / 255.f, bgColor[3].b / 255.f, 1));
-        bgShader.setUniform("whiteColor", Glsl::Vec4(bgColor[2].r / 255.f, bgColor[2].g / 255.f, bgColor[2].b / 255.f, 1));
-        bgShader.setUniform("greenColor", Glsl::Vec4(bgColor[4].r / 255.f, bgColor[4].g / 255.f, bgColor[4].b / 255.f, 1));
+        governor.create(config.frameBudget, effectsLevels.size());
+    }
+    //the match settings, modes and palettes, the command line setters still override them after
+    void SetConfig(const GameConfig& newConfig)
+    {
+        config = newConfig;
+        settings = config.match;
+        ballColors = config.ballColors;
+        bgColor = config.tileColors;
+        swapColors = config.swapColorsInterval;
+    }
+    void SetTickRate(float rate)
+    {
+        tickRate = rate;
+    }
+    void SetSeed(unsigned int seed)
+    {
+        settings.seed = seed;
+    }
+    void SetBallCount(int count)
+    {
+        settings.ballCount = max(count, 1);
+    }
+    void SetMapSize(const Vector2u& size)
+    {
+        settings.mapSize = Vector2u(max(size.x, 1U), max(size.y, 1U));
+    }
+    //fits the whole canvas in the window, the spare axis is padded to keep the aspect ratio
+    void ResetView()
+    {
+        const float aspect = static_cast<float>(screenSize.x) / screenSize.y;
+        Vector2f size = Vector2f(canvasSize);
+        if (size.x / size.y < aspect)
+            size.x = size.y * aspect;
+        else
+            size.y = size.x / aspect;
+        view.setSize(size);
+        view.setCenter(Vector2f(canvasSize) / 2.f);
+    }
+    //keeps the zoom between a few tiles and the whole canvas and the center on the canvas
+    void ClampView()
+    {
+        const float aspect = static_cast<float>(screenSize.x) / screenSize.y;
+        const float maxWidth = max(static_cast<float>(canvasSize.x), canvasSize.y * aspect);
+        const float minWidth = min(maxWidth, minViewTiles * tileSize.y * aspect);
+        const float width = min(max(view.getSize().x, minWidth), maxWidth);
+        view.setSize(width, width / aspect);
+        Vector2f center = view.getCenter();
+        center.x = min(max(center.x, 0.f), static_cast<float>(canvasSize.x));
+        center.y = min(max(center.y, 0.f), static_cast<float>(canvasSize.y));
+        view.setCenter(center);
+    }
+    void ZoomView(float factor, const Vector2i& pixel)
+    {
+        //zooms around the cursor so the point under it stays put
+        const Vector2f before = window.mapPixelToCoords(pixel, view);
+        view.zoom(factor);
+        ClampView();
+        view.move(before - window.mapPixelToCoords(pixel, view));
+        ClampView();
+    }
+    void PanView(const Vector2i& from, const Vector2i& to)
+    {
+        view.move(window.mapPixelToCoords(from, view) - window.mapPixelToCoords(to, view));
+        ClampView();
+    }
+    void SetFastForward(int ticksPerTick)
+    {
+        fastForward = max(ticksPerTick, 1);
+        if (speedText < 0)
+            return;
+        labels.setValue(speedText, fastForward);
+        labels.setVisible(speedText, fastForward > 1);
+    }
+    const EffectsLevel& Effects() const
+    {
+        return effectsLevels[governor.getLevel()];
+    }
+    //the frame phases are always recorded, the trace is written on exit when a path is set
+    void SetTracePath(const string& path)
+    {
+        tracePath = path;
+    }
+    void SaveTrace(const string& path)
+    {
+        if (profiler.saveTrace(path))
+            cout << "Wrote frame trace to " << path << "\n";
+        else
+            cout << "Could not write " << path << "\n";
+    }
+    void SetRecording(const string& path, int interval)
+    {
+        recordPath = path;
+        keyframeInterval = max(interval, 1);
+    }
+    //plays the replay back instead of simulating, the match settings come from the file
+    bool LoadReplay(const string& path)
+    {
+        if (!replay.loadFromFile(path))
+            return false;
+        replaying = true;
+        settings = replay.getSettings();
+        tickRate = replay.getTickRate();
+        return true;
+    }
+    void SaveRecording()
+    {
+        if (recordPath.empty() || replaying)
+            return;
+        if (replay.closeFile())
+            cout << "Recorded " << replay.getTickCount() << " ticks to " << recordPath << "\n";
+        else
+            cout << "Could not write " << recordPath << "\n";
+    }
+    //jumps to the tick and repaints every tile, the balls restart without interpolation
+    void Seek(int tick)
+    {
+        replay.Seek(playback, tick);
+        for (unsigned int i = 0; i < playback.map.getSize().x; i++)
+            for (unsigned int j = 0; j < playback.map.getSize().y; j++)
+                SetTile(i, j, playback.map(i, j));
+    }
+    const BallArrays& Balls() const
+    {
+        return replaying ? playback.balls : sim.getBalls();
+    }
+    const OwnershipGrid& Map() const
+    {
+        return replaying ? playback.map : sim.getMap();
+    }
+    const OwnedTiles& Owned() const
+    {
+        return replaying ? playback.owned : sim.getOwnedTiles();
+    }
+    const vector<int>& TotalTiles() const
+    {
+        return replaying ? playback.totalTiles : sim.getTotalTiles();
+    }
+    bool TeamPlaying(int team) const
+    {
+        if (!replaying)
+            return sim.getRanking().Contains(team);
+        return playback.eliminationTick[team] < 0;
+    }
+    //0 uses every core, the ball update only goes wide once there are enough balls to split
+    void SetThreadCount(unsigned int threads)
+    {
+#ifdef __EMSCRIPTEN__
+        threads = 1;
 #endif
-        Update();
+        workers.create(threads);
     }
-    void Increment(int i, const Vector2i& pos)
+    //only tests the balls that can be touching something, for maps with many fast balls
+    void SetEventDriven(bool enabled)
     {
-        counters[i].setString(to_string(totalTiles[i]));
-        counters[i].setOrigin(counters[i].getLocalBounds().width / 2, counters[i].getLocalBounds().height / 2);
+        sim.setEventDriven(enabled);
     }
-    void BallUpdate(const Time& delta)
+    void StartHeadless(int ticks)
     {
-        bool collided = false;
-        for (int i = 0; i < ballCount; i++)
-        {
-            if (balls[i].dead)
-                continue;
-            Vector2f prevPos = balls[i].ball.getPosition();
-            bool changedX = false;
-            bool changedY = false;
-            Vector2i tileID;
-            balls[i].ball.move(balls[i].dir.x * delta.asSeconds() * ballSpeed, 0);
-            if (Collided(i, tileID))
-            {
-                changedX = true;
-                balls[i].dir.x = -balls[i].dir.x;
-                collided = true;
-                Increment(i, tileID);
-
-                map[tileID.x][tileID.y] = i + 1;
-                for (int j = 0; j < 6; j++)
-                    arr[(tileID.y + tileID.x * mapSize.y) * 6 + j].color = bgColor[map[tileID.x][tileID.y]];
-            }
-            if (balls[i].ball.getPosition().x - ballRadius < 0)
-            {
-                changedX = true;
-                balls[i].dir.x = 1;
-            }
-            if (balls[i].ball.getPosition().x + ballRadius >= canvasSize.x)
-            {
-                changedX = true;
-                balls[i].dir.x = -1;
-            }
-            if (changedX)
-                balls[i].ball.move(balls[i].dir.x * delta.asSeconds() * ballSpeed, 0);
+        headless = true;
+        SetupSimulation();
 
-            balls[i].ball.move(0, balls[i].dir.y * delta.asSeconds() * ballSpeed);
-            if (Collided(i, tileID))
-            {
-                changedY = true;
-                balls[i].dir.y = -balls[i].dir.y;
-                collided = true;
-                Increment(i, tileID);
+        const Time delta = seconds(1.f / tickRate);
+        Clock clock;
+        int tick = 0;
+        if (replaying)
+        {
+            //a headless replay seeks to the tick and reports the state there
+            replay.Seek(playback, ticks);
+            tick = playback.tick;
+        }
+        else
+        {
+            while (sim.getTickCount() < ticks && !sim.isFinished())
+                Tick(delta, Time::Zero);
+            tick = sim.getTickCount();
+        }
+        const float elapsed = clock.getElapsedTime().asSeconds();
 
-                map[tileID.x][tileID.y] = i + 1;
-                for (int j = 0; j < 6; j++)
-                    arr[(tileID.y + tileID.x * mapSize.y) * 6 + j].color = bgColor[map[tileID.x][tileID.y]];
-            }
-            if (balls[i].ball.getPosition().y - ballRadius < 0)
-            {
-                changedY = true;
-                balls[i].dir.y = 1;
-            }
-            if (balls[i].ball.getPosition().y + ballRadius >= canvasSize.y)
-            {
-                changedY = true;
-                balls[i].dir.y = -1;
-            }
-            if (changedY)
-                balls[i].ball.move(0, balls[i].dir.y * delta.asSeconds() * ballSpeed);
-            const float steps = 4;
-            for (int k = 0; k < steps; k++)
-            {
-                ballTrail[i].setSpawnPosition(prevPos + k / steps * (balls[i].ball.getPosition() - prevPos));
-                ballTrail[i].Create();
-                ballTrail[i].Update(delta / steps);
-            }
+        cout << (replaying ? "Replayed " : "Simulated ") << tick << " ticks at " << tickRate << " Hz in " << elapsed << " s ("
+            << (elapsed > 0 ? tick / elapsed : 0) << " ticks/s)\n";
+        for (int i = 0; i < teamCount; i++)
+            cout << "Team " << i + 1 << ": " << TotalTiles()[i] << " tiles" << (TeamPlaying(i) ? "" : " (eliminated)") << "\n";
+        SaveRecording();
+    }
+    //effectDelta is how far the trails move on, zero skips effects for the tick
+    void Tick(const Time& delta, const Time& effectDelta)
+    {
+        effects = effectDelta > Time::Zero;
+        if (replaying)
+        {
+            if (!paused)
+                replay.Step(playback, [this](const Vector2i& tile, int previous, int owner) { TileChanged(tile, previous, owner); });
         }
-        for (int i = 0; i < balls.size(); i++)
-            totalTiles[i] = 0;
-        for (int i = 0; i < mapSize.x; i++)
-            for (int j = 0; j < mapSize.y; j++)
+        else
+        {
+            sim.Tick(delta);
+            if (!recordPath.empty())
+                replay.EndTick(sim);
+        }
+        if (headless || !effects)
+            return;
+        //the trails are a slice inside the ticks of the frame
+        const Uint64 trailStart = profiler.now();
+        const BallArrays& balls = Balls();
+        const float steps = Effects().trailSteps;
+        for (int k = 0; k < steps; k++)
+        {
+            for (int i = 0; i < balls.size(); i++)
             {
-                if (map[i][j] > 0)
-                    totalTiles[map[i][j] - 1]++;
+                if (!balls.alive[i])
+                    continue;
+                const Vector2f prevPos = balls.getPrevPosition(i);
+                ballTrail[balls.team[i]].setSpawnPosition(prevPos + k / steps * (balls.getPosition(i) - prevPos));
+                ballTrail[balls.team[i]].Create();
             }
-        for (int i = 0; i < balls.size(); i++)
+            for (auto& n : ballTrail)
+                n.Update(effectDelta / steps);
+        }
+        profiler.record(FrameProfiler::Phase::Trails, trailStart, profiler.now());
+    }
+    //only touches the counters whose value changed since the last frame
+    void UpdateCounters()
+    {
+        const vector<int>& totalTiles = TotalTiles();
+        for (int i = 0; i < teamCount; i++)
         {
-            if (balls[i].dead)
+            if (shownTiles[i] == totalTiles[i])
                 continue;
-            if (totalTiles[highestID] < totalTiles[i])
-            {
-                counters[highestID].setOutlineThickness(0);
-                counters[i].setOutlineThickness(3);
-
-                highestID = i;
-            }
-            if (totalTiles[lowestID] > totalTiles[i])
-                lowestID = i;
+            shownTiles[i] = totalTiles[i];
+            labels.setValue(counters[i], totalTiles[i]);
+        }
+        const int leader = replaying ? max_element(totalTiles.begin(), totalTiles.end()) - totalTiles.begin() : sim.getRanking().Leader();
+        if (leader != highestID)
+        {
+            labels.setOutline(counters[highestID], false);
+            labels.setOutline(counters[leader], true);
+            highestID = leader;
+        }
+        if (settings.timerMode)
+        {
+            const Time timer = replaying ? playback.timer : sim.getTimer();
+            labels.setValue(timerText, timer.asMilliseconds() / 100, 1);
         }
-        if (collided)
-            buff.update(&arr[0]);
     }
+    //a new snapshot goes out once the last one has been played, the labels follow
+    //the estimates as they come in
+    void UpdateEstimate(const Time& delta)
+    {
+        if (!estimating)
+            return;
+        estimateWait -= delta;
+        if (estimateWait <= Time::Zero && !winEstimator.isBusy() && !sim.isFinished())
+        {
+            sim.saveSnapshot(snapshot);
+            winEstimator.submit(snapshot);
+            estimateWait = estimateInterval;
+        }
+        const int tick = winEstimator.getEstimate(chances);
+        if (tick == chanceTick)
+            return;
+        chanceTick = tick;
+        for (int i = 0; i < teamCount && i < chances.size(); i++)
+            labels.setValue(chanceTexts[i], lround(chances[i] * 100));
+    }
+    //the modes are picked once here, every combination has its own copy of the frame loop
+    //with the parts of the disabled modes compiled out
     void Update()
+    {
+        const int mode = config.controllable | config.swapColors << 1 | config.borna << 2 | config.fancy << 3;
+        UpdateModes(mode, make_integer_sequence<int, 16>());
+    }
+    template<int... Modes>
+    void UpdateModes(int mode, integer_sequence<int, Modes...>)
+    {
+        using Loop = void (ToInfinity::*)();
+        static constexpr Loop loops[] = { &ToInfinity::UpdateLoop<(Modes & 1) != 0, (Modes & 2) != 0, (Modes & 4) != 0, (Modes & 8) != 0>... };
+        (this->*loops[mode])();
+    }
+    template<bool Controllable, bool SwapColors, bool Borna, bool Fancy>
+    void UpdateLoop()
     {
         Clock clock;
         Time delta;
-        Clock stopwatch;
+        Time accumulator = Time::Zero;
         while (window.isOpen())
         {
             delta = clock.restart();
+            if (delta > maxFrameTime)
+                delta = maxFrameTime;
+            const Uint64 frameStart = profiler.now();
+            Uint64 mark = frameStart;
             Event event;
             while (window.pollEvent(event))
             {
-#ifndef BORNAMODE
-                if (event.type == Event::Closed)
-                    window.close();
-                if (event.type == Event::KeyReleased)
+                if constexpr (!Borna)
                 {
-                    if (event.key.code == Keyboard::Escape)
+                    if (event.type == Event::Closed)
                         window.close();
+                    if (event.type == Event::KeyReleased)
+                    {
+                        if (event.key.code == Keyboard::Escape)
+                            window.close();
+                    }
+                }
+                //wheel zooms, dragging pans and home shows the whole map again
+                if (event.type == Event::MouseWheelScrolled)
+                    ZoomView(pow(0.85f, event.mouseWheelScroll.delta), Vector2i(event.mouseWheelScroll.x, event.mouseWheelScroll.y));
+                if (event.type == Event::MouseButtonPressed)
+                {
+                    panning = true;
+                    panStart = Vector2i(event.mouseButton.x, event.mouseButton.y);
+                }
+                if (event.type == Event::MouseButtonReleased)
+                    panning = false;
+                if (event.type == Event::MouseMoved && panning)
+                {
+                    const Vector2i mouse = Vector2i(event.mouseMove.x, event.mouseMove.y);
+                    PanView(panStart, mouse);
+                    panStart = mouse;
+                }
+                if (event.type == Event::KeyReleased && event.key.code == Keyboard::Home)
+                    ResetView();
+                //p prints the phase times of the last few thousand frames, t writes them as a trace
+                if (event.type == Event::KeyReleased && event.key.code == Keyboard::P)
+                    profiler.summary(cout);
+                if (event.type == Event::KeyReleased && event.key.code == Keyboard::T)
+                    SaveTrace(tracePath.empty() ? "trace.json" : tracePath);
+                if (event.type == Event::KeyReleased && event.key.code == Keyboard::F)
+                {
+                    const auto next = upper_bound(fastForwardSteps.begin(), fastForwardSteps.end(), fastForward);
+                    SetFastForward(next == fastForwardSteps.end() ? 1 : *next);
+                }
+                //replays seek with the arrows, a minute up and down, and pause with space
+                if (replaying && event.type == Event::KeyPressed)
+                {
+                    if (event.key.code == Keyboard::Left)
+                        Seek(playback.tick - seekTicks);
+                    if (event.key.code == Keyboard::Right)
+                        Seek(playback.tick + seekTicks);
+                    if (event.key.code == Keyboard::Down)
+                        Seek(playback.tick - seekTicks * 12);
+                    if (event.key.code == Keyboard::Up)
+                        Seek(playback.tick + seekTicks * 12);
+                    if (event.key.code == Keyboard::Space)
+                    {
+                        paused = !paused;
+                        playback.balls.prevX = playback.balls.x;
+                        playback.balls.prevY = playback.balls.y;
+                    }
                 }
-#endif
             }
-#ifdef FANCYMODE
-            bgShader.setUniform("time", stopwatch.getElapsedTime().asSeconds());
-            if (snowFlakeClock.getElapsedTime().asSeconds() > 1)
+            mark = profiler.lap(FrameProfiler::Phase::Events, mark);
+            if constexpr (Controllable)
             {
-                snowFlakeClock.restart();
-                snowFlakeSystem.setSpawnPosition(Vector2f(rand() % canvasSize.x, -50));
+                Vector2f ball0New = Vector2f();
+                Vector2f ball1New = Vector2f();
+                Vector2f ball2New = Vector2f();
+                if (Keyboard::isKeyPressed(Keyboard::W))
+                    ball0New.y = -1;
+                if (Keyboard::isKeyPressed(Keyboard::A))
+                    ball0New.x = -1;
+                if (Keyboard::isKeyPressed(Keyboard::S))
+                    ball0New.y = 1;
+                if (Keyboard::isKeyPressed(Keyboard::D))
+                    ball0New.x = 1;
+                if (Keyboard::isKeyPressed(Keyboard::I))
+                    ball1New.y = -1;
+                if (Keyboard::isKeyPressed(Keyboard::J))
+                    ball1New.x = -1;
+                if (Keyboard::isKeyPressed(Keyboard::K))
+                    ball1New.y = 1;
+                if (Keyboard::isKeyPressed(Keyboard::L))
+                    ball1New.x = 1;
+                if (Keyboard::isKeyPressed(Keyboard::Numpad8))
+                    ball2New.y = -1;
+                if (Keyboard::isKeyPressed(Keyboard::Numpad4))
+                    ball2New.x = -1;
+                if (Keyboard::isKeyPressed(Keyboard::Numpad5))
+                    ball2New.y = 1;
+                if (Keyboard::isKeyPressed(Keyboard::Numpad6))
+                    ball2New.x = 1;
+                const Vector2f newDirs[] = { normalize(ball0New), normalize(ball1New), normalize(ball2New) };
+                for (int i = 0; i < 3 && i < sim.getBalls().size(); i++)
+                    if (newDirs[i].x != 0 || newDirs[i].y != 0)
+                        sim.Steer(i, newDirs[i]);
+            }
+            const float alpha = Advance<SwapColors, Fancy>(delta, accumulator, mark);
+            UpdateEstimate(delta);
+            mark = profiler.lap(FrameProfiler::Phase::Estimate, mark);
+            Draw<Fancy>(window, alpha, mark);
+            //the wait for vsync in display() is not work, the governor only sees the rest
+            governor.update(microseconds(static_cast<Int64>((mark - frameStart) / 1000)));
+            window.display();
+            profiler.lap(FrameProfiler::Phase::Display, mark);
+            profiler.record(FrameProfiler::Phase::Frame, frameStart, profiler.now());
+        }
+    }
+    template<int... Modes>
+    void RenderModes(int mode, integer_sequence<int, Modes...>, RenderTexture& frame, FrameReadback& readback, FrameEncoder& encoder, int ticks, const Time& frameDelta)
+    {
+        using Loop = void (ToInfinity::*)(RenderTexture&, FrameReadback&, FrameEncoder&, int, const Time&);
+        static constexpr Loop loops[] = { &ToInfinity::RenderLoop<(Modes & 1) != 0, (Modes & 2) != 0>... };
+        (this->*loops[mode])(frame, readback, encoder, ticks, frameDelta);
+    }
+    //every frame advances by exactly frameDelta, the readback of a frame and its encoding
+    //run while the next frames are simulated and drawn
+    template<bool SwapColors, bool Fancy>
+    void RenderLoop(RenderTexture& frame, FrameReadback& readback, FrameEncoder& encoder, int ticks, const Time& frameDelta)
+    {
+        const auto submit = [&encoder](const Uint8* pixels, bool bottomUp) { encoder.submit(pixels, bottomUp); };
+        Time accumulator = Time::Zero;
+        while (true)
+        {
+            const int tick = replaying ? playback.tick : sim.getTickCount();
+            if (tick >= ticks || (replaying ? tick >= replay.getTickCount() : sim.isFinished()))
+                break;
+            const Uint64 frameStart = profiler.now();
+            Uint64 mark = frameStart;
+            const float alpha = Advance<SwapColors, Fancy>(frameDelta, accumulator, mark);
+            Draw<Fancy>(frame, alpha, mark);
+            frame.display();
+            readback.push(submit);
+            profiler.lap(FrameProfiler::Phase::Display, mark);
+            profiler.record(FrameProfiler::Phase::Frame, frameStart, profiler.now());
+        }
+        readback.finish(submit);
+    }
+    //the part of a frame between the input and the drawing, returns how far the balls
+    //are between the last two ticks
+    template<bool SwapColors, bool Fancy>
+    float Advance(const Time& delta, Time& accumulator, Uint64& mark)
+    {
+        const Time tickDelta = seconds(1.f / tickRate);
+        shaderTime += delta;
+        if constexpr (Fancy)
+        {
+            (textureTiles ? gridShader : bgShader).setUniform("time", shaderTime.asSeconds());
+            //no snow at all on the lowest level
+            snowFlakeTime += delta;
+            if (Effects().snowInterval > 0 && snowFlakeTime.asSeconds() > Effects().snowInterval)
+            {
+                snowFlakeTime = Time::Zero;
+                snowFlakeSystem.setSpawnPosition(Vector2f(snowFallRandom.nextInt(canvasSize.x), -50));
                 snowFlakeSystem.Create();
             }
             snowFlakeSystem.Update(delta);
-#endif
-#ifdef CONTROLLABLE
-            Vector2f ball0New = Vector2f();
-            Vector2f ball1New = Vector2f();
-            Vector2f ball2New = Vector2f();
-            if (Keyboard::isKeyPressed(Keyboard::W))
-                ball0New.y = -1;
-            if (Keyboard::isKeyPressed(Keyboard::A))
-                ball0New.x = -1;
-            if (Keyboard::isKeyPressed(Keyboard::S))
-                ball0New.y = 1;
-            if (Keyboard::isKeyPressed(Keyboard::D))
-                ball0New.x = 1;
-            if (Keyboard::isKeyPressed(Keyboard::I))
-                ball1New.y = -1;
-            if (Keyboard::isKeyPressed(Keyboard::J))
-                ball1New.x = -1;
-            if (Keyboard::isKeyPressed(Keyboard::K))
-                ball1New.y = 1;
-            if (Keyboard::isKeyPressed(Keyboard::L))
-                ball1New.x = 1;
-            if (Keyboard::isKeyPressed(Keyboard::Numpad8))
-                ball2New.y = -1;
-            if (Keyboard::isKeyPressed(Keyboard::Numpad4))
-                ball2New.x = -1;
-            if (Keyboard::isKeyPressed(Keyboard::Numpad5))
-                ball2New.y = 1;
-            if (Keyboard::isKeyPressed(Keyboard::Numpad6))
-                ball2New.x = 1;
-            if (ball0New.x != 0 || ball0New.y != 0)
-                balls[0].dir = normalize(ball0New);
-            if (ball1New.x != 0 || ball1New.y != 0)
-                balls[1].dir = normalize(ball1New);
-            if (ball2New.x != 0 || ball2New.y != 0)
-                balls[2].dir = normalize(ball2New);
-#endif
-#ifdef SWAPCOLORS
+            mark = profiler.lap(FrameProfiler::Phase::Snow, mark);
+        }
+        if constexpr (SwapColors)
+        {
             swapColors -= delta;
             if (swapColors < Time::Zero)
             {
-                swapColors = seconds(swapColorsCnt);
+                swapColors = config.swapColorsInterval;
                 bgColor.push_back(bgColor[1]);
                 bgColor.erase(bgColor.begin() + 1);
                 ballColors.push_back(ballColors[0]);
                 ballColors.erase(ballColors.begin());
-                for (int i = 0; i < ballCount; i++)
+                for (int i = 0; i < teamCount; i++)
                 {
-                    balls[i].ball.setFillColor(ballColors[i]);
+                    ballShapes[i].setFillColor(ballColors[i]);
                     ballTrail[i].setStartColor(ballColors[i]);
                     wallBreak[i + 1].setStartColor(bgColor[i + 1]);
                     wallBreak[i + 1].setEndColor(bgColor[i + 1]);
-                    counters[i].setFillColor(ballColors[i]);
+                    labels.setColor(counters[i], ballColors[i]);
+                    if (estimating)
+                        labels.setColor(chanceTexts[i], ballColors[i]);
                 }
-                for (int i = 0; i < mapSize.x; i++)
-                    for (int j = 0; j < mapSize.y; j++)
-                    {
-                        int index = map[i][j];
-                        if (index == 0)
-                            continue;
-                        for (int k = 0; k < 6; k++)
-                            arr[(i * mapSize.y + j) * 6 + k].color = bgColor[index];
-                    }
-            }
-#endif
-#ifdef TIMERMODE
-            timer -= delta;
-            if (timer < Time::Zero)
-            {
-                if (lowestID == highestID)
-                    timer = Time::Zero;
+                if (indexedTiles)
+                    UpdatePalette();
                 else
                 {
-                    balls[lowestID].dead = true;
-                    for (int i = 0; i < mapSize.x; i++)
-                        for (int j = 0; j < mapSize.y; j++)
-                            if (map[i][j] == lowestID + 1)
-                            {
-                                map[i][j] = 0;
-                                for (int k = 0; k < 6; k++)
-                                    arr[(i * mapSize.y + j) * 6 + k].color = bgColor[map[i][j]];
-                            }
-                    lowestID = highestID;
-                    timer = seconds(totalTimerCnt);
+                    const OwnedTiles& owned = Owned();
+                    for (int i = 1; i <= teamCount; i++)
+                        owned.forEach(i, [&](unsigned int x, unsigned int y) { tiles.setColor(x, y, bgColor[i]); });
                 }
             }
-            timerText.setString(to_string(timer.asMilliseconds() / 1000) + "." + to_string(timer.asMilliseconds() % 1000 / 100));
-#endif
-            BallUpdate(delta);
-
-            for (int i = 0; i < wallBreak.size(); i++)
-                wallBreak[i].Update(delta);
-
-            window.clear(bgColor[2]);
-            window.setView(view);
-
-            window.draw(snowFlakeSystem);
-#ifdef FANCYMODE
-            if (VertexBuffer::isAvailable())
-                window.draw(buff, &bgShader);
-            else
-                window.draw(arr, &bgShader);
-#else
-            if (VertexBuffer::isAvailable())
-                window.draw(buff);
+        }
+        //fast forward runs several ticks per frame, only the last one spawns effects
+        //and the tiles are still uploaded once per frame
+        accumulator += delta * static_cast<float>(fastForward);
+        int ticks = 0;
+        while (accumulator >= tickDelta)
+        {
+            accumulator -= tickDelta;
+            ticks++;
+            const bool last = accumulator < tickDelta || ticks == maxTicksPerFrame;
+            if (fastForward == 1)
+                Tick(tickDelta, tickDelta);
             else
-                window.draw(arr);
-#endif
-
-            for (int i = 0; i < wallBreak.size(); i++)
-                window.draw(wallBreak[i]);
-            for (int i = 0; i < ballTrail.size(); i++)
+                Tick(tickDelta, last ? delta : Time::Zero);
+            //the machine can not keep up, drop the rest instead of piling it up
+            if (ticks == maxTicksPerFrame)
             {
-                if (balls[i].dead)
-                    continue;
-                window.draw(ballTrail[i]);
+                accumulator = Time::Zero;
+                break;
             }
+        }
+        mark = profiler.lap(FrameProfiler::Phase::Ticks, mark);
+        const float alpha = accumulator / tickDelta;
+        UpdateCounters();
+        if (textureTiles)
+            tileTexture.flush();
+        else
+            tiles.flush(view);
+        mark = profiler.lap(FrameProfiler::Phase::Upload, mark);
 
-            for (auto& n : balls)
-            {
-                if (n.dead)
-                    continue;
-                window.draw(n.ball);
-            }
-            for (int i = 0; i < balls.size(); i++)
-            {
-                if (balls[i].dead)
-                    continue;
-                window.draw(counters[i]);
-            }
-            window.draw(timerText);
-            window.display();
+        for (int i = 0; i < wallBreak.size(); i++)
+            wallBreak[i].Update(delta);
+        mark = profiler.lap(FrameProfiler::Phase::WallBreak, mark);
+        return alpha;
+    }
+    template<bool Fancy>
+    void Draw(RenderTarget& target, float alpha, Uint64& mark)
+    {
+        target.clear(bgColor[2]);
+        target.setView(view);
+
+        target.draw(snowFlakeSystem);
+        mark = profiler.lap(FrameProfiler::Phase::DrawSnow, mark);
+        if (textureTiles)
+            target.draw(tileTexture, &gridShader);
+        else if constexpr (Fancy)
+            target.draw(tiles, &bgShader);
+        else
+            target.draw(tiles, indexedTiles ? &paletteShader : nullptr);
+        mark = profiler.lap(FrameProfiler::Phase::DrawTiles, mark);
+
+        for (int i = 0; i < wallBreak.size(); i++)
+            target.draw(wallBreak[i]);
+        for (int i = 0; i < ballTrail.size(); i++)
+            target.draw(ballTrail[i]);
+        mark = profiler.lap(FrameProfiler::Phase::DrawParticles, mark);
+
+        const FloatRect visible = FloatRect(view.getCenter() - view.getSize() / 2.f - Vector2f(ballRadius, ballRadius),
+            view.getSize() + Vector2f(ballRadius, ballRadius) * 2.f);
+        const BallArrays& balls = Balls();
+        for (int i = 0; i < balls.size(); i++)
+        {
+            if (!balls.alive[i])
+                continue;
+            const Vector2f prevPos = balls.getPrevPosition(i);
+            const Vector2f pos = prevPos + alpha * (balls.getPosition(i) - prevPos);
+            if (!visible.contains(pos))
+                continue;
+            target.draw(ballShapes[balls.team[i]], Transform().translate(pos));
+        }
+        mark = profiler.lap(FrameProfiler::Phase::DrawBalls, mark);
+        target.setView(hudView);
+        for (int i = 0; i < teamCount; i++)
+        {
+            labels.setVisible(counters[i], TeamPlaying(i));
+            if (estimating)
+                labels.setVisible(chanceTexts[i], TeamPlaying(i));
         }
+        target.draw(labels);
+        mark = profiler.lap(FrameProfiler::Phase::DrawHud, mark);
     }
 };
-int main()
+void PrintUsage()
 {
+    cout << "Usage: ToInfinity [--headless] [--seed S] [--ticks N] [--tickrate HZ] [--balls N] [--map WxH] [--threads N] [--events]\n"
+        << "    [--config FILE] [--record FILE] [--replay FILE] [--keyframes N] [--speed N] [--trace FILE] [--render FILE] [--fps N]\n";
+}
+int main(int argc, char** argv)
+{
+    bool headless = false;
+    unsigned int seed = 0;
+    int ticks = 120 * 60 * 5;
+    float tickRate = 120.f;
+    int ballCount = 0;
+    int threads = 0;
+    bool events = false;
+    string trace;
+    string render;
+    float fps = 60.f;
+    string configPath;
+    string record;
+    string replay;
+    int keyframes = 600;
+    int speed = 1;
+    Vector2u mapSize;
+    //a value that is no number stops with the usage text, the same way a bad --config does
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            string arg = argv[i];
+            if (arg == "--headless")
+                headless = true;
+            else if (arg == "--events")
+                events = true;
+            else if (arg == "--trace" && i + 1 < argc)
+                trace = argv[++i];
+            else if (arg == "--render" && i + 1 < argc)
+                render = argv[++i];
+            else if (arg == "--fps" && i + 1 < argc)
+                fps = stof(argv[++i]);
+            else if (arg == "--seed" && i + 1 < argc)
+                seed = stoul(argv[++i]);
+            else if (arg == "--ticks" && i + 1 < argc)
+                ticks = stoi(argv[++i]);
+            else if (arg == "--tickrate" && i + 1 < argc)
+                tickRate = stof(argv[++i]);
+            else if (arg == "--balls" && i + 1 < argc)
+                ballCount = stoi(argv[++i]);
+            else if (arg == "--threads" && i + 1 < argc)
+                threads = stoi(argv[++i]);
+            else if (arg == "--record" && i + 1 < argc)
+                record = argv[++i];
+            else if (arg == "--replay" && i + 1 < argc)
+                replay = argv[++i];
+            else if (arg == "--speed" && i + 1 < argc)
+                speed = stoi(argv[++i]);
+            else if (arg == "--config" && i + 1 < argc)
+                configPath = argv[++i];
+            else if (arg == "--keyframes" && i + 1 < argc)
+                keyframes = stoi(argv[++i]);
+            else if (arg == "--map" && i + 1 < argc)
+            {
+                //WIDTHxHEIGHT in tiles
+                const string size = argv[++i];
+                const size_t split = size.find('x');
+                if (split != string::npos)
+                {
+                    const int width = stoi(size.substr(0, split));
+                    const int height = stoi(size.substr(split + 1));
+                    if (width < 1 || height < 1)
+                        throw invalid_argument("--map");
+                    mapSize = Vector2u(width, height);
+                }
+            }
+        }
+    }
+    catch (const exception&)
+    {
+        cout << "Could not read the command line\n";
+        PrintUsage();
+        return 1;
+    }
+    //rates the tick and frame lengths come from, and counts the loops step by, have to be positive
+    if (!(tickRate > 0) || !isfinite(tickRate) || !(fps > 0) || !isfinite(fps) || threads < 0 || keyframes < 1 || speed < 1)
+    {
+        cout << "The tick rate, fps, keyframes and speed have to be positive and the thread count can not be negative\n";
+        PrintUsage();
+        return 1;
+    }
+    //video written to standard output keeps it clean, the messages go to the error stream
+    if (render == "-")
+        cout.rdbuf(cerr.rdbuf());
+    //the bundled config.txt is optional, one passed with --config has to load
+    GameConfig config;
+    if (!config.loadFromFile(configPath.empty() ? "config.txt" : configPath) && !configPath.empty())
+    {
+        cout << "Could not load config " << configPath << "\n";
+        return 1;
+    }
     ToInfinity app;
-    app.Start();
+    app.SetConfig(config);
+    app.SetSeed(seed);
+    app.SetTickRate(tickRate);
+    if (ballCount > 0)
+        app.SetBallCount(ballCount);
+    app.SetThreadCount(static_cast<unsigned int>(threads));
+    app.SetEventDriven(events);
+    app.SetTracePath(trace);
+    if (mapSize.x > 0 && mapSize.y > 0)
+        app.SetMapSize(mapSize);
+    app.SetRecording(record, keyframes);
+    app.SetFastForward(speed);
+    if (!replay.empty() && !app.LoadReplay(replay))
+    {
+        cout << "Could not load replay " << replay << "\n";
+        return 1;
+    }
+    if (headless)
+        app.StartHeadless(ticks);
+    else if (!render.empty())
+        return app.StartRender(render, ticks, fps) ? 0 : 1;
+    else
+        app.Start();
 }
\ No newline at end of file
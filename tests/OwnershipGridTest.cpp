@@ -0,0 +1,88 @@
+#include <SFML/System.hpp>
+#include "OwnershipGrid.h"
+#include <vector>
+#include <set>
+#include <iostream>
+#include <utility>
+using namespace sf;
+using namespace std;
+//checks the two grid layouts against each other, a map that is no multiple of the
+//block size leaves padding in the edge blocks that must never show up
+int failures = 0;
+void Check(bool condition, const char* what, OwnershipGrid::Layout layout)
+{
+    if (condition)
+        return;
+    failures++;
+    cout << (layout == OwnershipGrid::Layout::Tiled ? "Tiled" : "RowMajor") << ": " << what << "\n";
+}
+void TestLayout(OwnershipGrid::Layout layout)
+{
+    const Vector2u size = Vector2u(13, 10);
+    OwnershipGrid grid(size, layout);
+
+    //every tile has its own slot
+    set<size_t> indices;
+    for (unsigned int y = 0; y < size.y; y++)
+        for (unsigned int x = 0; x < size.x; x++)
+            indices.insert(grid.index(x, y));
+    Check(indices.size() == static_cast<size_t>(size.x) * size.y, "index is not unique per tile", layout);
+
+    //owner 1 on the last column and row, those sit in the edge blocks
+    set<pair<unsigned int, unsigned int>> expected;
+    for (unsigned int y = 0; y < size.y; y++)
+        for (unsigned int x = 0; x < size.x; x++)
+            if (x == size.x - 1 || y == size.y - 1)
+            {
+                grid(x, y) = 1;
+                expected.insert(make_pair(x, y));
+            }
+    grid(2, 3) = 2;
+    Check(grid(2, 3) == 2 && grid(3, 2) == 0, "tiles do not read back", layout);
+
+    const size_t total = static_cast<size_t>(size.x) * size.y;
+    Check(grid.count(1) == expected.size(), "count(1) is off", layout);
+    Check(grid.count(2) == 1, "count(2) is off", layout);
+    Check(grid.count(0) == total - expected.size() - 1, "count(0) sees the padding", layout);
+
+    vector<int> totals(3);
+    grid.countAll(totals);
+    Check(totals[0] == static_cast<int>(total - expected.size() - 1) && totals[1] == static_cast<int>(expected.size()) && totals[2] == 1, "countAll is off", layout);
+
+    set<pair<unsigned int, unsigned int>> visited;
+    grid.forEachOwned(1, [&](unsigned int x, unsigned int y) { visited.insert(make_pair(x, y)); });
+    Check(visited == expected, "forEachOwned visits the wrong tiles", layout);
+    size_t unowned = 0;
+    grid.forEachOwned(0, [&](unsigned int x, unsigned int y)
+        {
+            Check(x < size.x && y < size.y, "forEachOwned leaves the map", layout);
+            unowned++;
+        });
+    Check(unowned == total - expected.size() - 1, "forEachOwned(0) sees the padding", layout);
+
+    //regions are clipped to the map and only reach their own tiles
+    const OwnershipGrid::Region region = grid.region(IntRect(10, 8, 10, 10));
+    Check(region.left == 10 && region.top == 8 && region.right == 13 && region.bottom == 10, "region is not clipped", layout);
+    Check(region.get(9, 8) == nullptr && region.get(13, 9) == nullptr && region.get(12, 9) == &grid(12, 9), "region get is not checked", layout);
+    region.fill(3);
+    Check(grid.count(3) == 6 && grid(9, 9) == 1, "region fill is off", layout);
+    int last = -1;
+    bool ordered = true;
+    region.forEach([&](int x, int y, Uint8 owner)
+        {
+            ordered &= y * static_cast<int>(size.x) + x > last && owner == 3;
+            last = y * static_cast<int>(size.x) + x;
+        });
+    Check(ordered, "region forEach is not row by row", layout);
+
+    grid.fill(0);
+    Check(grid.count(0) == total, "fill is off", layout);
+}
+int main()
+{
+    TestLayout(OwnershipGrid::Layout::RowMajor);
+    TestLayout(OwnershipGrid::Layout::Tiled);
+    if (failures == 0)
+        cout << "OwnershipGrid ok\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+#include <SFML/System.hpp>
+#include "Replay.h"
+#include <vector>
+#include <string>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <cmath>
+using namespace sf;
+using namespace std;
+//records matches, plays them back from the saved bytes and compares every tick with the
+//simulation, a recording only holds the ball events that a bounce or elimination needs
+int failures = 0;
+void Check(bool condition, const string& what)
+{
+    if (condition)
+        return;
+    failures++;
+    cout << what << "\n";
+}
+struct Recorded
+{
+    vector<vector<Uint8>> maps;
+    vector<BallArrays> balls;
+    vector<vector<int>> totals;
+    vector<vector<int>> eliminations;
+    vector<Time> timers;
+    size_t tileChanges = 0;
+    size_t ballChanges = 0;
+};
+bool SameMap(const OwnershipGrid& a, const vector<Uint8>& b)
+{
+    size_t i = 0;
+    for (unsigned int y = 0; y < a.getSize().y; y++)
+        for (unsigned int x = 0; x < a.getSize().x; x++, i++)
+            if (a(x, y) != b[i])
+                return false;
+    return true;
+}
+bool SameBalls(const BallArrays& a, const BallArrays& b)
+{
+    for (size_t i = 0; i < a.size(); i++)
+        if (a.alive[i] != b.alive[i] || a.dx[i] != b.dx[i] || a.dy[i] != b.dy[i] || abs(a.x[i] - b.x[i]) > 0.05f || abs(a.y[i] - b.y[i]) > 0.05f)
+            return false;
+    return true;
+}
+void TestMatch(const string& name, const MatchSettings& settings, float tickRate, int ticks, int keyframeInterval)
+{
+    Simulation sim;
+    Replay recorder;
+    Recorded recorded;
+    sim.onTileChanged = [&](const Vector2i& tile, int previous, int owner)
+        {
+            recorder.RecordTile(tile, owner);
+            recorded.tileChanges++;
+        };
+    sim.Setup(settings);
+    recorder.Begin(sim, tickRate, keyframeInterval);
+    const filesystem::path path = filesystem::temp_directory_path() / "ReplayTest.rpl";
+    Check(recorder.openFile(path), name + ": could not open " + path.string());
+    const Time delta = seconds(1.f / tickRate);
+    for (int t = 0; t < ticks && !sim.isFinished(); t++)
+    {
+        const BallArrays before = sim.getBalls();
+        sim.Tick(delta);
+        recorder.EndTick(sim);
+        const BallArrays& balls = sim.getBalls();
+        for (size_t i = 0; i < balls.size(); i++)
+            recorded.ballChanges += balls.dx[i] != before.dx[i] || balls.dy[i] != before.dy[i] || balls.alive[i] != before.alive[i];
+        vector<Uint8> map;
+        for (unsigned int y = 0; y < settings.mapSize.y; y++)
+            for (unsigned int x = 0; x < settings.mapSize.x; x++)
+                map.push_back(sim.getMap()(x, y));
+        recorded.maps.push_back(map);
+        recorded.balls.push_back(balls);
+        recorded.totals.push_back(sim.getTotalTiles());
+        recorded.eliminations.push_back(sim.getEliminationTicks());
+        recorded.timers.push_back(sim.getTimer());
+    }
+    Check(recorder.getTileEventCount() == recorded.tileChanges, name + ": tile events do not match the tile changes");
+    Check(recorder.getBallEventCount() == recorded.ballChanges, name + ": " + to_string(recorder.getBallEventCount()) + " ball events for "
+        + to_string(recorded.ballChanges) + " direction changes");
+
+    string data;
+    recorder.saveToMemory(data);
+    //the file written during the match holds the same bytes
+    Check(recorder.closeFile(), name + ": could not write " + path.string());
+    stringstream file;
+    file << ifstream(path, ios::binary).rdbuf();
+    Check(file.str() == data, name + ": the file written during the match differs");
+    filesystem::remove(path);
+    Replay replay;
+    Check(replay.loadFromMemory(data, data.size()), name + ": the recording does not load");
+    Check(replay.getTickCount() == static_cast<int>(recorded.maps.size()), name + ": tick count is off");
+
+    //playing through and seeking have to land on the recorded state
+    Replay::State state;
+    replay.Seek(state, 0);
+    for (size_t t = 0; t < recorded.maps.size(); t++)
+    {
+        replay.Step(state, [](const Vector2i&, int, int) {});
+        if (!SameMap(state.map, recorded.maps[t]) || !SameBalls(state.balls, recorded.balls[t]) || state.totalTiles != recorded.totals[t]
+            || state.eliminationTick != recorded.eliminations[t] || state.timer != recorded.timers[t])
+        {
+            Check(false, name + ": playback differs on tick " + to_string(t + 1));
+            break;
+        }
+    }
+    for (int tick : { 1, keyframeInterval, keyframeInterval + 7, static_cast<int>(recorded.maps.size()) / 2, static_cast<int>(recorded.maps.size()) })
+    {
+        replay.Seek(state, tick);
+        Check(state.tick == tick && SameMap(state.map, recorded.maps[tick - 1]) && SameBalls(state.balls, recorded.balls[tick - 1])
+            && state.eliminationTick == recorded.eliminations[tick - 1] && state.timer == recorded.timers[tick - 1],
+            name + ": seeking to " + to_string(tick) + " differs");
+    }
+
+    //a recording cut off by a crash keeps its whole segments
+    for (size_t size : { data.size() / 3, data.size() - 1 })
+    {
+        Replay cut;
+        Check(cut.loadFromMemory(data, size), name + ": a cut recording does not load");
+        const int ticks = cut.getTickCount();
+        Check(ticks > 0 && ticks <= replay.getTickCount() && ticks % keyframeInterval == 0, name + ": a cut recording keeps " + to_string(ticks) + " ticks");
+        if (ticks <= 0)
+            continue;
+        cut.Seek(state, ticks);
+        Check(state.tick == ticks && SameMap(state.map, recorded.maps[ticks - 1]) && SameBalls(state.balls, recorded.balls[ticks - 1]),
+            name + ": a cut recording plays back differently");
+    }
+}
+int main()
+{
+    MatchSettings small;
+    small.seed = 4;
+    TestMatch("4 balls", small, 120.f, 12000, 600);
+
+    MatchSettings crowd;
+    crowd.seed = 9;
+    crowd.ballCount = 300;
+    crowd.mapSize = Vector2u(96, 54);
+    TestMatch("300 balls", crowd, 120.f, 1500, 250);
+
+    MatchSettings timer = small;
+    timer.timerMode = true;
+    timer.timerLength = seconds(10);
+    TestMatch("timer at 90 Hz", timer, 90.f, 6000, 300);
+
+    //teams without balls are eliminated without a ball going out
+    MatchSettings empty = timer;
+    empty.ballCount = 3;
+    empty.teamCount = 6;
+    empty.timerLength = seconds(5);
+    TestMatch("more teams than balls", empty, 120.f, 6000, 400);
+
+    if (failures == 0)
+        cout << "Replay ok\n";
+    return failures == 0 ? 0 : 1;
+}
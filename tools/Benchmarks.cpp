@@ -0,0 +1,392 @@
+#include <SFML/Graphics.hpp>
+#include "ZLE.h"
+#include "BallKernel.h"
+#include "Simulation.h"
+#include <vector>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+using namespace sf;
+using namespace std;
+//microbenchmarks of the hot paths, every scenario is seeded so two runs measure the same work
+//and the json output can be diffed between commits
+
+//every allocation of the process goes through here so a scenario can report how many it made
+atomic<Uint64> allocations{0};
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void* ptr = malloc(size > 0 ? size : 1))
+        return ptr;
+    throw bad_alloc();
+}
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+//gcc inlines the deletes into code that got its memory from operator new and then takes
+//the free for a mismatch, but every new above hands out malloc memory
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+void operator delete[](void* ptr) noexcept
+{
+    free(ptr);
+}
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+void operator delete[](void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+struct Result
+{
+    string name;
+    int batch = 1;
+    int samples = 0;
+    double mean = 0;
+    double min = 0;
+    double p50 = 0;
+    double p90 = 0;
+    double p99 = 0;
+    double allocations = 0;
+};
+double Percentile(vector<double> values, double fraction)
+{
+    const size_t k = min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+class Bench
+{
+public:
+    string filter;
+    double minTime = 0.5;
+    bool list = false;
+    vector<Result> results;
+
+    //prepare runs untimed before every sample, a sample times body batch times and the
+    //percentiles are over the per op time of the samples
+    void Run(const string& name, int batch, const function<void()>& prepare, const function<void(int)>& body)
+    {
+        if (!filter.empty() && name.find(filter) == string::npos)
+            return;
+        if (list)
+        {
+            cout << name << "\n";
+            return;
+        }
+        for (int i = 0; i < WarmupSamples; i++)
+        {
+            prepare();
+            for (int k = 0; k < batch; k++)
+                body(k);
+        }
+        vector<double> times;
+        Uint64 allocated = 0;
+        double total = 0;
+        while ((total < minTime || times.size() < MinSamples) && times.size() < MaxSamples)
+        {
+            prepare();
+            const Uint64 before = allocations.load(memory_order_relaxed);
+            const auto start = chrono::steady_clock::now();
+            for (int k = 0; k < batch; k++)
+                body(k);
+            const auto end = chrono::steady_clock::now();
+            allocated += allocations.load(memory_order_relaxed) - before;
+            const double elapsed = chrono::duration<double>(end - start).count();
+            total += elapsed;
+            times.push_back(elapsed * 1e9 / batch);
+        }
+        Result result;
+        result.name = name;
+        result.batch = batch;
+        result.samples = static_cast<int>(times.size());
+        for (double n : times)
+            result.mean += n;
+        result.mean /= times.size();
+        result.min = *min_element(times.begin(), times.end());
+        result.p50 = Percentile(times, 0.5);
+        result.p90 = Percentile(times, 0.9);
+        result.p99 = Percentile(times, 0.99);
+        result.allocations = static_cast<double>(allocated) / (static_cast<double>(times.size()) * batch);
+        cout << left << setw(48) << result.name << right << fixed << setprecision(1) << setw(14) << result.mean << setw(14) << result.p50
+            << setw(14) << result.p99 << setprecision(2) << setw(12) << result.allocations << "\n";
+        results.push_back(result);
+    }
+    bool SaveJson(const string& path) const
+    {
+        ofstream file(path);
+        if (!file.is_open())
+            return false;
+        file << "{\n  \"unit\": \"ns/op\",\n  \"results\": [";
+        file << fixed << setprecision(3);
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result& n = results[i];
+            file << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << n.name << "\", \"batch\": " << n.batch << ", \"samples\": " << n.samples
+                << ", \"mean\": " << n.mean << ", \"min\": " << n.min << ", \"p50\": " << n.p50 << ", \"p90\": " << n.p90 << ", \"p99\": " << n.p99
+                << ", \"allocs_per_op\": " << n.allocations << "}";
+        }
+        file << "\n  ]\n}\n";
+        return static_cast<bool>(file);
+    }
+private:
+    static constexpr int WarmupSamples = 3;
+    static constexpr size_t MinSamples = 20;
+    static constexpr size_t MaxSamples = 100000;
+};
+//keeps the compiler from dropping work whose result is never used
+volatile Uint64 sink = 0;
+
+void CircleRectangle(Bench& bench)
+{
+    const int count = 4096;
+    zle::Random random(1);
+    vector<Vector2f> positions(count);
+    vector<FloatRect> rects(count);
+    for (int i = 0; i < count; i++)
+    {
+        positions[i] = Vector2f(random.nextFloat() * 200, random.nextFloat() * 200);
+        rects[i] = FloatRect(random.nextFloat() * 200, random.nextFloat() * 200, 60, 60);
+    }
+    Uint64 hits = 0;
+    bench.Run("Circle_Rectangle", count, [] {}, [&](int k) { hits += Circle_Rectangle(positions[k], 20, rects[k]); });
+    sink = sink + hits;
+}
+//the ball against tile test of the kernel, what Collided was before the ball arrays
+void FindTileHits(Bench& bench, const Vector2u& mapSize, int teams)
+{
+    const int count = 4096;
+    zle::Random random(2);
+    OwnershipGrid map(mapSize);
+    for (unsigned int x = 0; x < mapSize.x; x++)
+        for (unsigned int y = 0; y < mapSize.y; y++)
+            map(x, y) = static_cast<Uint8>(random.nextInt(teams + 1));
+    SweepParams params;
+    params.tileSize = Vector2f(60, 60);
+    params.canvasSize = Vector2f(mapSize.x * 60.f, mapSize.y * 60.f);
+    params.radius = 20;
+    params.delta = 1 / 120.f;
+    params.speed = 800;
+    params.steps = 1;
+    vector<Vector2f> positions(count);
+    vector<Uint8> team(count);
+    for (int i = 0; i < count; i++)
+    {
+        positions[i] = Vector2f(random.nextFloat() * params.canvasSize.x, random.nextFloat() * params.canvasSize.y);
+        team[i] = static_cast<Uint8>(random.nextInt(teams));
+    }
+    Uint64 hits = 0;
+    BallHit hit;
+    bench.Run("FindTileHit/" + to_string(mapSize.x) + "x" + to_string(mapSize.y), count, [] {},
+        [&](int k) { hits += FindTileHit(positions[k], team[k], params, map, hit); });
+    sink = sink + hits;
+}
+//one op is a whole tick of the ball update, the match restarts untimed once it is over
+void SimulationTicks(Bench& bench, const Vector2u& mapSize, int balls, bool eventDriven, bool collisions = false)
+{
+    MatchSettings settings;
+    settings.seed = 3;
+    settings.mapSize = mapSize;
+    settings.ballCount = balls;
+    settings.ballCollisions = collisions;
+    Simulation sim;
+    sim.setEventDriven(eventDriven);
+    sim.Setup(settings);
+    const Time delta = seconds(1 / 120.f);
+    const int batch = 16;
+    const auto prepare = [&]()
+    {
+        if (sim.isFinished() || sim.getTickCount() > 120 * 60 * 10)
+            sim.Setup(settings);
+    };
+    bench.Run(string("Simulation::Tick/") + (eventDriven ? "events/" : "polling/") + (collisions ? "collisions/" : "") + to_string(mapSize.x) + "x" + to_string(mapSize.y)
+        + "/" + to_string(balls) + " balls", batch, prepare, [&](int) { sim.Tick(delta); });
+}
+void Particles(Bench& bench, zle::ParticleSystem::ParticleType type, const string& typeName)
+{
+    const int count = 2000;
+    zle::ParticleSystem system;
+    system.setParticleType(type);
+    system.setCreateOnUpdate(false);
+    system.setMaxParticles(count);
+    system.setRandomSeed(4);
+    //creating fills an empty system, updating moves a full one that never expires
+    system.setLifeTime(1);
+    bench.Run("ParticleSystem::Create/" + typeName, count, [&]() { system.Update(seconds(100)); }, [&](int) { system.Create(); });
+    system.setLifeTime(1e6f);
+    system.Update(seconds(100));
+    for (int i = 0; i < count; i++)
+        system.Create();
+    bench.Run("ParticleSystem::Update/" + typeName + "/" + to_string(count), 1, [] {}, [&](int) { system.Update(seconds(1 / 120.f)); });
+}
+//DrawUpdate runs inside draw, so an op is a tile change and a draw into a 1x1 texture
+void TileMapRebuild(Bench& bench, RenderTexture& target, const Vector2u& mapSize)
+{
+    zle::TileMap map;
+    map.setTileCount(mapSize);
+    map.setTileSize(Vector2u(60, 60));
+    map.setTextureTileSize(Vector2u(16, 16));
+    target.draw(map);
+    zle::Random random(5);
+    const string size = to_string(mapSize.x) + "x" + to_string(mapSize.y);
+    bench.Run("TileMap::DrawUpdate/texcoords/" + size, 1, [] {}, [&](int)
+    {
+        map.setTileID(Vector2u(random.nextInt(mapSize.x), random.nextInt(mapSize.y)), static_cast<unsigned short>(random.nextInt(16)));
+        target.draw(map);
+    });
+    bench.Run("TileMap::DrawUpdate/full/" + size, 1, [] {}, [&](int)
+    {
+        map.setTileSize(Vector2u(60, 60));
+        map.setColor(Color::White);
+        map.setTileID(Vector2u(0, 0), 0);
+        target.draw(map);
+    });
+}
+template<typename T>
+void Write(string& data, const T& value)
+{
+    data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+void WriteString(string& data, const string& value)
+{
+    Write(data, static_cast<Uint32>(value.size()));
+    data += value;
+}
+//there is no level writer, so the level is put together here in the 1.6 layout with
+//tilemaps and particle systems that need no asset files
+string MakeLevel(int tileMaps, const Vector2u& mapSize, int particleSystems)
+{
+    string data;
+    WriteString(data, zle::ZLE_VERSION);
+    Write(data, 0);
+    Write(data, tileMaps + particleSystems);
+    for (int i = 0; i < tileMaps + particleSystems; i++)
+    {
+        const bool tileMap = i < tileMaps;
+        WriteString(data, (tileMap ? "map" : "particles") + to_string(i));
+        Write(data, Color::White);
+        Write(data, tileMap ? zle::ObjectType::TileMap : zle::ObjectType::ParticleSystem);
+        //texture, fragment and vertex shader, visible, layer, blend mode
+        Write(data, -1);
+        Write(data, -1);
+        Write(data, -1);
+        Write(data, 1);
+        Write(data, 0);
+        Write(data, 2);
+        Write(data, Vector2f(0, 0));
+        Write(data, 0.f);
+        Write(data, Vector2f(1, 1));
+        Write(data, Vector2f(0, 0));
+        Write(data, false);
+        if (tileMap)
+        {
+            Write(data, static_cast<unsigned short>(0));
+            Write(data, static_cast<unsigned short>(0));
+            Write(data, Vector2u(16, 16));
+            Write(data, mapSize);
+            Write(data, Vector2u(60, 60));
+            for (unsigned int k = 0; k < mapSize.x * mapSize.y; k++)
+                Write(data, static_cast<Uint16>(k % 16));
+        }
+        else
+        {
+            zle::ParticleSystem system;
+            system.saveToMemory(data, true);
+        }
+    }
+    return data;
+}
+void LevelLoad(Bench& bench, int tileMaps, const Vector2u& mapSize, int particleSystems)
+{
+    const string data = MakeLevel(tileMaps, mapSize, particleSystems);
+    bool loaded = true;
+    bench.Run("Level::loadFromStream/" + to_string(tileMaps) + " maps " + to_string(mapSize.x) + "x" + to_string(mapSize.y) + "/"
+        + to_string(particleSystems) + " systems", 1, [] {}, [&](int)
+    {
+        MemoryInputStream stream;
+        stream.open(data.data(), data.size());
+        zle::Level level;
+        loaded = level.loadFromStream(stream) && loaded;
+    });
+    if (!loaded)
+        cout << "Level::loadFromStream rejected the generated level\n";
+}
+int main(int argc, char** argv)
+{
+    Bench bench;
+    string json;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--json" && i + 1 < argc)
+            json = argv[++i];
+        else if (arg == "--filter" && i + 1 < argc)
+            bench.filter = argv[++i];
+        else if (arg == "--time" && i + 1 < argc)
+            bench.minTime = stod(argv[++i]);
+        else if (arg == "--list")
+            bench.list = true;
+    }
+    if (!bench.list)
+        cout << left << setw(48) << "scenario" << right << setw(14) << "mean ns/op" << setw(14) << "p50 ns/op" << setw(14) << "p99 ns/op"
+            << setw(12) << "allocs/op" << "\n";
+
+    CircleRectangle(bench);
+    FindTileHits(bench, Vector2u(32, 18), 4);
+    FindTileHits(bench, Vector2u(256, 144), 4);
+    const Vector2u maps[] = { Vector2u(32, 18), Vector2u(128, 72), Vector2u(512, 288) };
+    const int ballCounts[] = { 4, 64, 1024 };
+    for (auto& map : maps)
+        for (int balls : ballCounts)
+            for (bool eventDriven : { false, true })
+                SimulationTicks(bench, map, balls, eventDriven);
+    for (int balls : { 1024, 8192 })
+        SimulationTicks(bench, Vector2u(128, 72), balls, false, true);
+    const pair<zle::ParticleSystem::ParticleType, string> types[] = { { zle::ParticleSystem::ParticleType::Points, "Points" },
+        { zle::ParticleSystem::ParticleType::Lines, "Lines" }, { zle::ParticleSystem::ParticleType::Triangles, "Triangles" },
+        { zle::ParticleSystem::ParticleType::Quads, "Quads" }, { zle::ParticleSystem::ParticleType::QuadsTriangles, "QuadsTriangles" } };
+    for (auto& n : types)
+        Particles(bench, n.first, n.second);
+    //the tilemap needs a context to draw into, without one those scenarios are skipped
+    RenderTexture target;
+    if (target.create(1, 1))
+    {
+        TileMapRebuild(bench, target, Vector2u(32, 18));
+        TileMapRebuild(bench, target, Vector2u(256, 144));
+    }
+    else if (!bench.list)
+        cout << "No render texture, skipped the TileMap scenarios\n";
+    LevelLoad(bench, 1, Vector2u(32, 18), 1);
+    LevelLoad(bench, 8, Vector2u(128, 72), 8);
+
+    if (!json.empty())
+    {
+        if (!bench.SaveJson(json))
+        {
+            cout << "Could not write " << json << "\n";
+            return 1;
+        }
+        cout << "Wrote " << bench.results.size() << " results to " << json << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,237 @@
+#include <SFML/System.hpp>
+#include "Simulation.h"
+#include "WorkerPool.h"
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+#include <cmath>
+using namespace sf;
+using namespace std;
+//runs batches of headless ToInfinity matches on every core and writes one csv row per match
+struct Match
+{
+    MatchSettings settings;
+    int maxTicks = 120 * 60 * 5;
+    bool eventDriven = false;
+};
+struct Outcome
+{
+    //-1 when the match ran out of ticks before a single team was left
+    int winner = -1;
+    bool finished = false;
+    int ticks = 0;
+    vector<int> totalTiles;
+    vector<int> eliminationTicks;
+};
+Vector2u ParseSize(const string& size)
+{
+    //WIDTHxHEIGHT in tiles
+    const size_t split = size.find('x');
+    const int width = stoi(size.substr(0, split));
+    const int height = split == string::npos ? width : stoi(size.substr(split + 1));
+    if (width < 1 || height < 1)
+        throw invalid_argument("map size");
+    return Vector2u(width, height);
+}
+//one match per line: seed,balls,teams,width,height,timer seconds (0 = off),max ticks,
+//a row that does not read stops the run rather than leaving a hole in the results
+bool LoadPlan(const string& path, bool eventDriven, vector<Match>& matches)
+{
+    ifstream file(path);
+    if (!file.is_open())
+    {
+        cerr << "Could not open " << path << "\n";
+        return false;
+    }
+    string line;
+    for (int number = 1; getline(file, line); number++)
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+        for (auto& n : line)
+            if (n == ',')
+                n = ' ';
+        istringstream row(line);
+        Match match;
+        match.eventDriven = eventDriven;
+        int width = 0;
+        int height = 0;
+        float timer = 0;
+        if (!(row >> match.settings.seed >> match.settings.ballCount >> match.settings.teamCount >> width >> height >> timer >> match.maxTicks)
+            || !(row >> ws).eof())
+        {
+            cerr << path << " line " << number << ": expected seed,balls,teams,width,height,timer,ticks\n";
+            return false;
+        }
+        if (width < 1 || height < 1)
+        {
+            cerr << path << " line " << number << ": the map needs at least one tile on each side\n";
+            return false;
+        }
+        match.settings.mapSize = Vector2u(width, height);
+        match.settings.timerMode = timer > 0;
+        if (timer > 0)
+            match.settings.timerLength = seconds(timer);
+        matches.push_back(match);
+    }
+    return true;
+}
+Outcome Play(const Match& match, float tickRate)
+{
+    Simulation sim;
+    sim.setEventDriven(match.eventDriven);
+    sim.Setup(match.settings);
+    const Time delta = seconds(1.f / tickRate);
+    while (sim.getTickCount() < match.maxTicks && !sim.isFinished())
+        sim.Tick(delta);
+    Outcome outcome;
+    outcome.finished = sim.isFinished();
+    outcome.winner = outcome.finished ? sim.getRanking().Leader() : -1;
+    outcome.ticks = sim.getTickCount();
+    outcome.totalTiles = sim.getTotalTiles();
+    outcome.eliminationTicks = sim.getEliminationTicks();
+    return outcome;
+}
+void PrintUsage()
+{
+    cerr << "Usage: TournamentRunner [--matches N] [--seed S] [--balls N] [--teams N] [--map WxH] [--timer SECONDS]\n"
+        << "    [--ticks N] [--tickrate HZ] [--threads N] [--events] [--collisions] [--plan matches.csv] [--out results.csv]\n";
+}
+int main(int argc, char** argv)
+{
+    Match base;
+    int matchCount = 100;
+    float tickRate = 120.f;
+    int threads = 0;
+    string plan;
+    string out = "results.csv";
+    //a value that is no number ends up at the usage text like an unknown option
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            string arg = argv[i];
+            if (arg == "--matches" && i + 1 < argc)
+                matchCount = stoi(argv[++i]);
+            else if (arg == "--seed" && i + 1 < argc)
+                base.settings.seed = stoul(argv[++i]);
+            else if (arg == "--balls" && i + 1 < argc)
+                base.settings.ballCount = stoi(argv[++i]);
+            else if (arg == "--teams" && i + 1 < argc)
+                base.settings.teamCount = stoi(argv[++i]);
+            else if (arg == "--map" && i + 1 < argc)
+                base.settings.mapSize = ParseSize(argv[++i]);
+            else if (arg == "--timer" && i + 1 < argc)
+            {
+                const float timer = stof(argv[++i]);
+                base.settings.timerMode = timer > 0;
+                if (timer > 0)
+                    base.settings.timerLength = seconds(timer);
+            }
+            else if (arg == "--ticks" && i + 1 < argc)
+                base.maxTicks = stoi(argv[++i]);
+            else if (arg == "--tickrate" && i + 1 < argc)
+                tickRate = stof(argv[++i]);
+            else if (arg == "--threads" && i + 1 < argc)
+                threads = stoi(argv[++i]);
+            else if (arg == "--events")
+                base.eventDriven = true;
+            else if (arg == "--collisions")
+                base.settings.ballCollisions = true;
+            else if (arg == "--plan" && i + 1 < argc)
+                plan = argv[++i];
+            else if (arg == "--out" && i + 1 < argc)
+                out = argv[++i];
+            else
+            {
+                PrintUsage();
+                return 1;
+            }
+        }
+    }
+    catch (const exception&)
+    {
+        PrintUsage();
+        return 1;
+    }
+    if (!(tickRate > 0) || !isfinite(tickRate) || threads < 0)
+    {
+        cerr << "The tick rate has to be positive and the thread count can not be negative\n";
+        PrintUsage();
+        return 1;
+    }
+
+    //without a plan every match uses the command line settings with consecutive seeds
+    vector<Match> matches;
+    if (!plan.empty())
+    {
+        if (!LoadPlan(plan, base.eventDriven, matches))
+            return 1;
+        for (auto& n : matches)
+            n.settings.ballCollisions = base.settings.ballCollisions;
+    }
+    else
+        for (int i = 0; i < matchCount; i++)
+        {
+            matches.push_back(base);
+            matches.back().settings.seed = base.settings.seed + i;
+        }
+
+    //every match owns its simulation, so they only share the pool that hands them out
+    vector<Outcome> outcomes(matches.size());
+    WorkerPool pool(static_cast<unsigned int>(threads));
+    Clock clock;
+    pool.run(matches.size(), [&](int i)
+        {
+            outcomes[i] = Play(matches[i], tickRate);
+        });
+    const float elapsed = clock.getElapsedTime().asSeconds();
+
+    ofstream file(out);
+    if (!file.is_open())
+    {
+        cerr << "Could not write " << out << "\n";
+        return 1;
+    }
+    int maxTeams = 0;
+    for (auto& n : outcomes)
+        maxTeams = max(maxTeams, static_cast<int>(n.totalTiles.size()));
+    file << "match,seed,balls,teams,map_width,map_height,timer,ticks,finished,winner";
+    for (int t = 0; t < maxTeams; t++)
+        file << ",tiles_" << t + 1;
+    for (int t = 0; t < maxTeams; t++)
+        file << ",eliminated_" << t + 1;
+    file << "\n";
+    long long totalTicks = 0;
+    for (int i = 0; i < matches.size(); i++)
+    {
+        const MatchSettings& settings = matches[i].settings;
+        const Outcome& outcome = outcomes[i];
+        totalTicks += outcome.ticks;
+        file << i << "," << settings.seed << "," << settings.ballCount << "," << outcome.totalTiles.size() << ","
+            << settings.mapSize.x << "," << settings.mapSize.y << "," << (settings.timerMode ? settings.timerLength.asSeconds() : 0) << ","
+            << outcome.ticks << "," << outcome.finished << ",";
+        //the winner stays empty for matches that hit the tick limit, the leader then is no winner
+        if (outcome.finished)
+            file << outcome.winner + 1;
+        //elimination columns hold the tick the team went out on and stay empty for survivors
+        for (int t = 0; t < maxTeams; t++)
+        {
+            file << ",";
+            if (t < outcome.totalTiles.size())
+                file << outcome.totalTiles[t];
+        }
+        for (int t = 0; t < maxTeams; t++)
+        {
+            file << ",";
+            if (t < outcome.eliminationTicks.size() && outcome.eliminationTicks[t] >= 0)
+                file << outcome.eliminationTicks[t];
+        }
+        file << "\n";
+    }
+    cout << "Played " << matches.size() << " matches (" << totalTicks << " ticks) on " << pool.getThreadCount() << " threads in "
+        << elapsed << " s, results in " << out << "\n";
+}